@@ -4,7 +4,7 @@
 python3 polygongenerator.py
 
 # Compile and run daa.cpp
-g++-11 -o ./src/daa ./src/DAAFinal.cpp
+g++-11 -O2 -pthread -o ./src/daa ./src/DAAFinal.cpp
 ./src/daa
 
 # Run decomppolygen.py
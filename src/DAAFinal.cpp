@@ -1,54 +1,64 @@
 #include <bits/stdc++.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 using namespace std;
 
 class HalfEdge;
-class Vertex;
+template<class T> class BasicVertex;
 class Face;
-class DCEL;
+
+/// @brief Index of a Vertex, HalfEdge or Face inside the arenas of its DCEL.
+typedef uint32_t Id;
+
+/// @brief Id used for links that are not set yet.
+const Id NIL = UINT32_MAX;
+
+/// @brief Wraps the statements that fill in Metrics. They are only compiled when the program is built with -DDAA_METRICS,
+/// so the decomposition does not pay for them otherwise.
+#ifdef DAA_METRICS
+#define METRIC(statement) statement
+#else
+#define METRIC(statement)
+#endif
 
 /// @brief Directed edge of a DCEL.
-/// This represents an edge originating from the origin Vertex.
+/// This represents an edge originating from the origin Vertex. All links are indices into the arenas of the owning DCEL.
 /// @param origin This Vertex is the origin of the half-edge
 /// @param twin This half edge represents the equivalent edge in the opposite direction which is inbound on the origin
 /// @param face This represents the face associated with this half-edge
 /// @param next This represents the half-edge that follows the current half-edge
+/// @param prev This represents the half-edge that comes before the current half-edge
 class HalfEdge {
 public:
-    Vertex* origin;
-    HalfEdge* twin;
-    Face* face;
-    HalfEdge* next;
+    Id origin;
+    Id twin;
+    Id face;
+    Id next;
+    Id prev;
 
-    /// @brief Constructor of the HalfEdge class. It sets everything to NULL
-    HalfEdge() : origin(nullptr), twin(nullptr), face(nullptr), next(nullptr){}
+    /// @brief Constructor of the HalfEdge class. It sets everything to NIL
+    HalfEdge() : origin(NIL), twin(NIL), face(NIL), next(NIL), prev(NIL){}
 };
 
 /// @brief Point in the DCEL.
 /// This class represents a singular point in the DCEL. 
+/// @tparam T Type of the coordinates, the Value of the coordinate policy of the DCEL
 /// @param x X-coordinate of the vertex
 /// @param y y-coordinate of the vertex
 /// @param incidentEdge The HalfEdge originating from the current vertex
-/// @param prev The HalfEdge originating from the current vertex but in the opposite direction
-class Vertex {
+template<class T> class BasicVertex {
 public:
-    double x;
-    double y;
-    HalfEdge* incidentEdge;
-    HalfEdge* prev; //danger, works only on face 0
-
-    /// @brief This function calculates the x value of the coordinate of intersection of the line passing through v1,v2 and the line passing through the current vertice, parallel to the x axis.
-    /// @param v1 This is the first Vertex of the line
-    /// @param v2 This is the second Vertex of the line
-    /// @return Returns the x value of the point of intersection of the line passing through v1,v2 and the line passing through the current vertice, parallel to the x axis.
-    double intersection(Vertex* v1, Vertex* v2);
-
-    /// @brief This function returns if the Vertex calling the function is on the same side of the line created by v1 and v2 as last[Lm]
-    /// @param v1 First Vertex of the line
-    /// @param v2 Second Vertex of the line
-    /// @param val Val is the value returned when you evaluate last[lm] on the line created by v1 and v1
-    /// @return Returns a boolean value of whether the point is on the correct side or not
-    bool side(Vertex* v1, Vertex* v2, int val);
+    T x;
+    T y;
+    Id incidentEdge;
 
     /// @brief This function checks if the vertex calling is inside the rectangle defined by x1, x2, y1, y2
     /// @param x1 Vertex of the rectangle
@@ -56,464 +66,5282 @@ public:
     /// @param y1 Vertex of the rectangle
     /// @param y2 Vertex of the rectangle
     /// @return Returns true if the vertex is inside the rectangle
-    bool insideRect(double x1, double x2, double y1, double y2);
-
-    /// @brief Checks if the calling vertex is inside the polygon created with st as first vertex and ed as last vertex. It Uses the ray casting algorithm to find if the point is inside the polygon or not.
-    /// @param st starting Vertex of the polygon
-    /// @param ed ending Vertex of the polygon
-    /// @return true if the calling vertex is inside the polygon.
-    bool inside(Vertex* st, Vertex* ed);
-
-    /// @brief Finds and returns the next Vertex
-    /// @return Returns the next Vertex
-    Vertex* next();
+    bool insideRect(T x1, T x2, T y1, T y2) const;
 
-    Vertex(double x_, double y_) : x(x_), y(y_), incidentEdge(nullptr) {}
-    Vertex(double x_, double y_, HalfEdge* incidentEdge_) : x(x_), y(y_), incidentEdge(incidentEdge_) {}
+    BasicVertex(T x_, T y_) : x(x_), y(y_), incidentEdge(NIL) {}
+    BasicVertex(T x_, T y_, Id incidentEdge_) : x(x_), y(y_), incidentEdge(incidentEdge_) {}
 };
 
+/// @brief The vertices of DCEL, and of everything that reads, writes or generates polygons
+using Vertex = BasicVertex<double>;
+
 /// @brief Class to represent the Face of a polygon.
 /// This class represents the Face of a polygon
 /// @param outerComponent The HalfEdge that we use to represent our face
+/// @param mergedInto The face this one was merged into by DCEL::merging, NIL while the face is still whole
 class Face {
 public:
-    HalfEdge* outerComponent;
-    Face() : outerComponent(nullptr) {}
+    Id outerComponent;
+    Id mergedInto;
+    Face() : outerComponent(NIL), mergedInto(NIL) {}
+};
+
+/// @brief An entry of the lists in which algorithm1 keeps what a failed start depended on, see BasicDCEL::watchHead
+/// @param start The start whose candidate polygon collapsed
+/// @param stamp The stamp of that candidate polygon, the entry is stale once the start is tried again
+/// @param next The next entry of the same list, NIL at its end
+class StartWatch {
+public:
+    Id start;
+    uint32_t stamp;
+    Id next;
+};
+
+/// @brief What an Edit does to its vertex
+enum class EditKind { Move, Insert, Delete };
+
+/// @brief One change to the polygon of a DCEL that is already decomposed, see DCEL::update
+/// @param kind Whether the vertex moves to x, y, gets a new vertex at x, y after it, or is deleted
+/// @param vertex Id of the vertex
+/// @param x X-coordinate the vertex moves to or the new vertex gets, unused by Delete
+/// @param y Y-coordinate the vertex moves to or the new vertex gets, unused by Delete
+class Edit {
+public:
+    EditKind kind;
+    Id vertex;
+    double x;
+    double y;
+};
+
+/// @brief Uniform grid over the notches of face 0 that are not decomposed yet.
+/// algorithm1 uses it as LPVS, so that the bounding rectangle of a candidate only visits the notches in the cells it overlaps.
+/// The notches are stored grouped by cell in one array, and a notch is deleted by overwriting its slot, so the others never move.
+/// @tparam T Type of the coordinates, the Value of the coordinate policy of the DCEL
+/// @param minX Smallest x-coordinate covered by the grid
+/// @param minY Smallest y-coordinate covered by the grid
+/// @param cellW Width of a cell
+/// @param cellH Height of a cell
+/// @param cols Number of columns of cells
+/// @param rows Number of rows of cells
+/// @param cellStart Offset of the first notch of each cell in items
+/// @param cellCount Number of notches of each cell, for the counting sort of build
+/// @param items The notches, grouped by cell
+/// @param itemX X-coordinate of each notch of items, removedSlot for the slots of removed notches so that no rectangle test passes them
+/// @param itemY Y-coordinate of each notch of items, removedSlot for the slots of removed notches
+/// @param pos Position of each vertex in items, NIL if it is not in the grid
+/// @param size Number of live notches in the grid
+template<class T> class BasicNotchGrid {
+public:
+    double minX, minY, cellW, cellH;
+    int cols, rows;
+    Id size;
+    vector<Id> cellStart;
+    vector<Id> cellCount;
+    vector<Id> items;
+    vector<T> itemX;
+    vector<T> itemY;
+    vector<Id> pos;
+
+    /// @brief Fills the grid with the given notches, sizing the cells so that each holds about two notches
+    /// @param P The vertices of the polygon
+    /// @param notches The notches to put in the grid
+    void build(const vector<BasicVertex<T>>& P, const vector<Id>& notches);
+
+    /// @brief Removes v from the grid if it is in it, in O(1). The other notches keep their slots, so a query visits them in the same order
+    /// before and after, which algorithm1 relies on to skip the starts it already knows to fail
+    /// @param v Vertex to remove
+    void remove(Id v);
+
+    /// @brief Finds the column of cells an x-coordinate falls in, clamped to the grid
+    /// @param x The x-coordinate
+    /// @return The column
+    int col(double x) const;
+
+    /// @brief Finds the row of cells an y-coordinate falls in, clamped to the grid
+    /// @param y The y-coordinate
+    /// @return The row
+    int row(double y) const;
+};
+
+/// @brief The coordinate BasicNotchGrid writes into the slots of removed notches: NaN for floating point, which fails every
+/// comparison, and the largest integer otherwise, which is beyond the coordinates the integer policies take
+/// @return The coordinate
+template<class T> T removedSlot();
+
+/// @brief What algorithm1, split and merging did for one polygon, or for all the polygons of a batch once added up.
+/// Only filled in when the program is built with -DDAA_METRICS, see METRIC.
+/// @param polygons Number of polygons these numbers are about
+/// @param vertices Number of vertices of those polygons
+/// @param notches Number of notches of the input polygons
+/// @param iterations Outer iterations of algorithm1, one per candidate polygon L[m]
+/// @param lpvsTotal Size of LPVS at every iteration, added up. Divided by iterations, it is the average number of notches left
+/// @param lpvsMax Largest size of LPVS at an iteration
+/// @param rectTests Slots of the grid cells under the rectangle of L[m] that were tested against the rectangle, removed notches included
+/// @param rectRejects Those of the tested slots that were outside of the rectangle or of the wedge at the first vertex of L[m]
+/// @param insideTests Calls of insideConvex, for the notches inside the rectangle
+/// @param backtracks Times a notch inside L[m] made us cut L[m] back
+/// @param collapses Times the notch was on the line through the first and last vertex, and L[m] fell back to a single edge
+/// @param splits Faces cut off by split, or the diagonals of triangulate
+/// @param merged Diagonals removed by merging
+/// @param kept Diagonals that are left after merging
+/// @param setupTime Seconds spent finding the notches and building the grid
+/// @param algorithm1Time Seconds spent in algorithm1, setupTime and splitTime included, or in triangulate
+/// @param splitTime Seconds spent in split
+/// @param mergingTime Seconds spent in merging
+class Metrics {
+public:
+    uint64_t polygons = 0;
+    uint64_t vertices = 0;
+    uint64_t notches = 0;
+    uint64_t iterations = 0;
+    uint64_t lpvsTotal = 0;
+    uint64_t lpvsMax = 0;
+    uint64_t rectTests = 0;
+    uint64_t rectRejects = 0;
+    uint64_t insideTests = 0;
+    uint64_t backtracks = 0;
+    uint64_t collapses = 0;
+    uint64_t splits = 0;
+    uint64_t merged = 0;
+    uint64_t kept = 0;
+    double setupTime = 0;
+    double algorithm1Time = 0;
+    double splitTime = 0;
+    double mergingTime = 0;
+
+    /// @brief Adds the numbers of another polygon or batch to these, lpvsMax is the larger of the two
+    /// @param other The numbers to add
+    void add(const Metrics& other);
+
+    /// @brief Formats the numbers as the members of a JSON object, without the braces
+    /// @return The JSON text
+    string json() const;
+};
+
+/// @brief Seconds on a steady clock, for the phase times of Metrics
+/// @return The time
+double steadySeconds();
+
+/// @brief The order the vertices of a polygon go around in, see inspect
+enum class Winding { CounterClockwise, Clockwise };
+
+template<class T> class BasicKernels;
+
+/// @brief Coordinate policy of BasicDCEL for doubles, any input fits in it. orient is exact with its fallback to orientExact, and
+/// the kernels are the AVX2 ones when the CPU has AVX2
+/// @param Value The type the coordinates are stored in
+/// @param Det The type orient returns, whose sign is the side
+class DoubleCoords {
+public:
+    using Value = double;
+    using Det = double;
+
+    /// @brief The orientation test on Values, exact, see orient
+    static Det orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy);
+
+    /// @brief The kernels algorithm1 runs on Values
+    static const BasicKernels<Value>& kernels();
+};
+
+/// @brief Coordinate policy of BasicDCEL for floats, half the bytes of doubles for coordinates that are floats exactly. A double
+/// holds every float and orient is exact for any doubles, so the test is orient on the coordinates turned into doubles
+class FloatCoords {
+public:
+    using Value = float;
+    using Det = double;
+    static Det orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy);
+    static const BasicKernels<Value>& kernels();
+};
+
+/// @brief Largest magnitude, excluded, of the coordinates of Int32Coords. The differences of two coordinates are then below 2^31,
+/// their products below 2^62 and the determinant of orient below 2^63, so it is exact in 64 bit integers
+const double INT32_LIMIT = 0x1p30;
+
+/// @brief Largest magnitude, excluded, of the coordinates of Int64Coords, the determinant is then below 2^127
+const double INT64_LIMIT = 0x1p62;
+
+/// @brief Coordinate policy of BasicDCEL for integer coordinates below INT32_LIMIT, like the ones of tiles and grids. The
+/// determinant of orient is computed exactly in 64 bit integers, with no error bound to check and no fallback
+class Int32Coords {
+public:
+    using Value = int32_t;
+    using Det = int64_t;
+    static Det orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy);
+    static const BasicKernels<Value>& kernels();
+};
 
-    /// @brief We use this function to get the previous Vertex within a face
-    /// @param v We get the Vertex that is the previous of v along the edges of the face calling this function.
-    /// @return Thre preivious vertex along the face
-    Vertex* prev(Vertex* v);
+/// @brief Coordinate policy of BasicDCEL for integer coordinates below INT64_LIMIT, the determinant is computed exactly in 128 bit
+/// integers and orient only returns its sign
+class Int64Coords {
+public:
+    using Value = int64_t;
+    using Det = int;
+    static Det orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy);
+    static const BasicKernels<Value>& kernels();
 };
 
 /// @brief Class to represent a doubly connected edge list. This is the class we use to decompose the polygon.
 /// This class represents our implimentation of the doubly connected edge list. 
-/// @param vertices This is a list of all of the vertices in the dcel
-/// @param halfEdges This is a list of all halfedges in the dcel
-/// @param faces This is a list of all faces in the dcel
+/// Vertices, half-edges and faces live in contiguous arenas and refer to each other by their index, so a single DCEL
+/// can be reset() and rebuilt for every polygon of a batch without going back to the allocator once its arenas are warm.
+/// It is a template on how it stores its coordinates and on the winding of its polygons, so that algorithm1 and merging are compiled
+/// for each of them with the orientation tests inlined, and nothing is decided at run time in their loops. Most of the program
+/// uses DCEL, doubles in counter-clockwise order, triangulate and update only exist for it. For Winding::Clockwise every orientation
+/// test is mirrored by swapping two of its points, so the inside of a face is on the right of its half-edges instead of the left
+/// @tparam C The coordinate policy, DoubleCoords, FloatCoords, Int32Coords or Int64Coords
+/// @tparam W The winding of the polygons it holds
+/// @param vertices This is the arena of all of the vertices in the dcel
+/// @param xs X-coordinates of the vertices in one contiguous array, filled in by build() for the kernels of Kernels
+/// @param ys Y-coordinates of the vertices in one contiguous array
+/// @param halfEdges This is the arena of all halfedges in the dcel
+/// @param faces This is the arena of all faces in the dcel, the index of a face is its id
 /// @param diags This is the list of all the new edges that we add to the polygon in-order to decompose it
-/// @param mp We use this map to link an integer i to the face of the ith polygon that we have decomposed
-/// @param mp1 We use this map to link a Face to its assigned integer
-/// @param LDP We use this vector to keep track if the ith face is part of the final decomposed polygon or not. We use mp and mp1 inorder to get to index of the face we want to check.
-class DCEL {
-public:
-    vector<Vertex*> vertices;
-    vector<HalfEdge*> halfEdges;
-    vector<Face*> faces;
-    vector<HalfEdge*> diags;
-    map<int,Face*> mp;
-    map<Face*,int> mp1;
+/// @param LDP We use this vector to keep track if the ith face is part of the final decomposed polygon or not.
+/// @param LPVS Grid of the notches of face 0 that are not part of a decomposed face yet
+/// @param mark Stamp of the last candidate polygon L[m] that the vertex was part of
+/// @param failed Stamp of the candidate polygon with which algorithm1 last failed to cut anything off from the vertex as a start, 0 once
+/// that may have changed
+/// @param watchHead First entry in watches of the list of the failed starts that depend on the vertex, NIL if there is none
+/// @param watches The entries of those lists
+/// @param pending A bit for every vertex that algorithm1 has to try as a start, it does not know it to fail
+/// @param pendingWords A bit for every word of pending that is not 0, so that the next start is found in a few words
+/// @param metrics What the last decomposition did, see Metrics
+template<class C = DoubleCoords, Winding W = Winding::CounterClockwise> class BasicDCEL {
+public:
+    using Value = typename C::Value;
+    using Point = BasicVertex<Value>;
+
+    vector<Point> vertices;
+    vector<Value> xs;
+    vector<Value> ys;
+    vector<HalfEdge> halfEdges;
+    vector<Face> faces;
+    vector<Id> diags;
     vector<bool> LDP;
-    DCEL(vector<Vertex*>& vertices);
+    vector<Id> boundary; // the inner half-edge of the polygon boundary that leaves each vertex, NIL once update deleted it
+    BasicNotchGrid<Value> LPVS;
+    vector<uint32_t> mark;
+    vector<uint32_t> failed;
+    vector<Id> watchHead;
+    vector<StartWatch> watches;
+    vector<uint64_t> pending;
+    vector<uint64_t> pendingWords;
+    Metrics metrics;
+
+    BasicDCEL() {}
+    BasicDCEL(const vector<Point>& vertices);
+
+    /// @brief orient of C on a, b and c, with b and c swapped for Winding::Clockwise
+    /// @return A number that is positive if a, b, c turn towards the inside of a polygon of winding W, negative if they turn
+    /// towards the outside and 0 if they are on one line
+    static typename C::Det turn(const Point& a, const Point& b, const Point& c);
+
+    /// @brief The test of a convex corner of the members, in the winding W
+    /// @return true if v0 v1 v2 turn towards the inside or are on one line, false for a reflex angle
+    static bool signedArea(const Point& v0, const Point& v1, const Point& v2);
+
+    /// @brief Empties the DCEL in O(1) while keeping the capacity of its arenas for the next polygon
+    void reset();
+
+    /// @brief Appends a vertex of the input polygon, the polygon is linked up by build()
+    /// @param x X-coordinate of the vertex
+    /// @param y Y-coordinate of the vertex
+    /// @return The id of the new vertex
+    Id addVertex(Value x, Value y);
+
+    /// @brief Creates the half-edges and the single face of the polygon made by the vertices added so far, in the winding W
+    void build();
+
+    /// @brief Finds and returns the next Vertex
+    /// @param v Vertex whose successor we want
+    /// @return Returns the next Vertex
+    Id next(Id v) const;
+
+    /// @brief Finds the Vertex before v on face 0 in O(1), using the prev link of the halfedge leaving v
+    /// @param v Vertex of face 0 whose predecessor we want
+    /// @return Returns the previous Vertex on face 0
+    Id before(Id v) const;
+
+    /// @brief Checks if v is a notch of face 0, that is if the angle of face 0 at v is reflex
+    /// @param v Vertex of face 0
+    /// @return true if v is a notch
+    bool isNotch(Id v) const;
+
+    /// @brief Finds the face that the half-edge e currently belongs to. The face field of an edge is not rewritten when
+    /// merging joins two faces, so we follow mergedInto from it and shorten the path as we go
+    /// @param e The half-edge
+    /// @return The id of the face
+    Id faceOf(Id e);
 
     /// @brief This function splits the Face into two faces or two plygons using v1 and v2 as the diagonal
     /// @param v1 One end of the diagonal with which we want to split the Face
     /// @param v2 One end of the diagonal with which we want to split the Face
-    void split(Vertex*v1, Vertex* v2);
+    void split(Id v1, Id v2);
 
     /// @brief This function implements algorithm 1 from the paper
-    void algorithm1();
+    /// @param start The vertex the first candidate polygon L[1] starts from, the number of pieces depends on it
+    /// @param bound Number of diagonals of the best run so far when several runs race, nullptr if there is none. We give up as
+    /// soon as we are sure to end up with more diagonals than that
+    /// @param budget Work we may do, counted as vertices added to the candidate polygons, grid slots tested and vertices tested
+    /// when backtracking. We give up once it is used up
+    /// @return false if we gave up, the DCEL is then only partly decomposed
+    bool algorithm1(Id start = 0, const atomic<Id>* bound = nullptr, uint64_t budget = UINT64_MAX);
+
+    /// @brief Links diagonals into a DCEL that was just built, or that only got diagonals from addDiagonals since, as if split had
+    /// added them, so that merging can run on them. The diagonals must not cross each other, every face gets a new id in faces
+    /// @param diagonals The pairs of vertices to connect
+    void addDiagonals(const vector<pair<Id,Id>>& diagonals);
+
+    /// @brief Triangulates the polygon in O(n log n), the first half of the Hertel-Mehlhorn decomposition, merging is the second.
+    /// A sweep from top to bottom adds the diagonals that split the polygon into y-monotone faces, and every monotone face is
+    /// then triangulated in linear time. Runs on a DCEL that was just built, in place of algorithm1. Only for DCEL
+    void triangulate();
 
     /// @brief This function implements the merging algorithm from the paper
-    void merging();
+    /// @param from Index in diags of the first diagonal that may be removed, the ones before it are kept as they are
+    void merging(size_t from = 0);
+
+    /// @brief The test merging does on one diagonal: if removing it leaves no notch at either end, the two faces are joined into a new one
+    /// @param d One of the two half-edges of the diagonal
+    /// @return true if the diagonal was removed
+    bool merge(Id d);
+
+    /// @brief Applies vertex edits to a polygon that is already decomposed, instead of decomposing it again from scratch. For every
+    /// edit we dissolve the pieces at the vertex and its neighbours and the pieces the new edges run into, decompose that region on
+    /// its own with algorithm1 and merging, link its pieces back in, and try to merge only the diagonals on the border of the region.
+    /// The time depends on the pieces the edit touches, not on the size of the polygon. A moved vertex keeps its id, an inserted one
+    /// gets the next free id and a deleted one is left unused. The polygon must stay simple: the new edges are only checked against
+    /// the region, not against the rest of the polygon. Only for DCEL
+    /// @param edits The edits, applied in order
+    /// @return The number of edits applied. We stop at the first one whose new edges cross the boundary of the polygon, or that would
+    /// leave fewer than 3 vertices, and the DCEL keeps what the edits before it did
+    size_t update(const vector<Edit>& edits);
 };
 
-Vertex* Face::prev(Vertex* v){
-    HalfEdge* e = this->outerComponent;
-    while(e->next->origin!= v){ // We go through all the halfedges of the face until we reach the previous vertex
-        e = e->next;
+/// @brief The DCEL most of the program works with, doubles in counter-clockwise order
+using DCEL = BasicDCEL<>;
+
+void Metrics::add(const Metrics& other){
+    this->polygons += other.polygons;
+    this->vertices += other.vertices;
+    this->notches += other.notches;
+    this->iterations += other.iterations;
+    this->lpvsTotal += other.lpvsTotal;
+    this->lpvsMax = max(this->lpvsMax, other.lpvsMax);
+    this->rectTests += other.rectTests;
+    this->rectRejects += other.rectRejects;
+    this->insideTests += other.insideTests;
+    this->backtracks += other.backtracks;
+    this->collapses += other.collapses;
+    this->splits += other.splits;
+    this->merged += other.merged;
+    this->kept += other.kept;
+    this->setupTime += other.setupTime;
+    this->algorithm1Time += other.algorithm1Time;
+    this->splitTime += other.splitTime;
+    this->mergingTime += other.mergingTime;
+}
+
+string Metrics::json() const{
+    ostringstream out;
+    out << setprecision(9) << "\"polygons\": " << this->polygons << ", \"vertices\": " << this->vertices << ", \"notches\": " << this->notches
+        << ", \"iterations\": " << this->iterations << ", \"lpvsTotal\": " << this->lpvsTotal << ", \"lpvsMax\": " << this->lpvsMax
+        << ", \"rectTests\": " << this->rectTests << ", \"rectRejects\": " << this->rectRejects << ", \"insideTests\": " << this->insideTests
+        << ", \"backtracks\": " << this->backtracks << ", \"collapses\": " << this->collapses << ", \"splits\": " << this->splits
+        << ", \"merged\": " << this->merged << ", \"kept\": " << this->kept << ", \"setupTime\": " << this->setupTime
+        << ", \"algorithm1Time\": " << this->algorithm1Time << ", \"splitTime\": " << this->splitTime << ", \"mergingTime\": " << this->mergingTime;
+    return out.str();
+}
+
+double steadySeconds(){
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<class C, Winding W> Id BasicDCEL<C, W>::before(Id v) const{
+    return this->halfEdges[this->halfEdges[this->vertices[v].incidentEdge].prev].origin;
+}
+
+template<class C, Winding W> Id BasicDCEL<C, W>::faceOf(Id e){
+    Id f = this->halfEdges[e].face;
+    while(this->faces[f].mergedInto != NIL) f = this->faces[f].mergedInto;
+    Id g = this->halfEdges[e].face;
+    while(g != f){ // we point every face on the way straight to the face we found
+        Id up = this->faces[g].mergedInto;
+        this->faces[g].mergedInto = f;
+        g = up;
     }
-    return e->origin;
+    this->halfEdges[e].face = f;
+    return f;
 }
 
-void DCEL::split(Vertex*v1, Vertex* v2){
-    HalfEdge* one = new HalfEdge(); // we create the two halfedges of the diagonal
-    HalfEdge* two = new HalfEdge();
+template<class C, Winding W> void BasicDCEL<C, W>::split(Id v1, Id v2){
+    METRIC(double st = steadySeconds());
+    Id one = this->halfEdges.size(); // we create the two halfedges of the diagonal
+    Id two = one + 1;
+    this->halfEdges.emplace_back();
+    this->halfEdges.emplace_back();
     this->diags.push_back(one); // we include this diagonal into diags for when we merge later
-    one->twin = two;
-    two->twin = one;
-    one->origin = v1;
-    two->origin = v2; // we initialise the origins of the half edge diagonal and its twin
+    vector<HalfEdge>& he = this->halfEdges;
+    vector<Point>& vs = this->vertices;
+    he[one].twin = two;
+    he[two].twin = one;
+    he[one].origin = v1;
+    he[two].origin = v2; // we initialise the origins of the half edge diagonal and its twin
 
-    Face* small = new Face(); // we create a new face 
-    small->outerComponent = two; // assign two to the new face
-    this->faces[0]->outerComponent = one; // assign one to the existing face
+    Id small = this->faces.size(); // we create a new face 
+    this->faces.emplace_back();
+    this->faces[small].outerComponent = two; // assign two to the new face
+    this->faces[0].outerComponent = one; // assign one to the existing face
 
-    HalfEdge* e = v1->incidentEdge;
-    while(e->origin!=v2) // assign all the edges of the new face to 'small'
+    Id e = vs[v1].incidentEdge;
+    while(he[e].origin!=v2) // assign all the edges of the new face to 'small'
     {
-        e->face = small;
-        e = e->next;
+        he[e].face = small;
+        e = he[e].next;
     }
-    two->face = small; //assign one and two to its respective faces
-    one->face = this->faces[0];
+    he[two].face = small; //assign one and two to its respective faces
+    he[one].face = 0;
     
-    one->next = v2->incidentEdge;  // reconnect the edges adjacent to the diagonal to their correct next edges
-    two->next = v1->incidentEdge;
-    v2->prev->twin->next = two;   
-    v1->prev->twin->next = one;
-    v2->prev = two;
+    Id in1 = he[vs[v1].incidentEdge].prev, in2 = he[vs[v2].incidentEdge].prev; // the edges of face 0 that come into v1 and v2
+    he[one].next = vs[v2].incidentEdge;  // reconnect the edges adjacent to the diagonal to their correct next and prev edges
+    he[two].next = vs[v1].incidentEdge;
+    he[one].prev = in1;
+    he[two].prev = in2;
+    he[in2].next = two;   
+    he[in1].next = one;
+    he[he[one].next].prev = one;
+    he[he[two].next].prev = two;
+
+    vs[v1].incidentEdge = one;
+    METRIC(this->metrics.splits++; this->metrics.splitTime += steadySeconds() - st);
+}
+
+template<class C, Winding W> BasicDCEL<C, W>::BasicDCEL(const vector<Point>& inp) {
+    for(const Point& v: inp) this->addVertex(v.x, v.y);
+    this->build();
+}
 
-    v1->incidentEdge = one;
-    this->faces.push_back(small);
+template<class C, Winding W> void BasicDCEL<C, W>::reset() {
+    this->vertices.clear(); // the arenas hold trivially destructible records, so clearing them is O(1) and keeps their storage
+    this->halfEdges.clear();
+    this->faces.clear();
+    this->diags.clear();
+    this->LDP.clear();
+    this->boundary.clear();
+    this->mark.clear();
+    this->failed.clear();
+    this->watchHead.clear();
+    this->watches.clear();
+    this->pending.clear();
+    this->pendingWords.clear();
+    METRIC(this->metrics = Metrics());
+}
 
-    mp[this->faces.size()-1] = small; // we map small to its index and vice versa
-    mp1[small] = this->faces.size()-1;
+template<class C, Winding W> Id BasicDCEL<C, W>::addVertex(Value x, Value y) {
+    this->vertices.emplace_back(x, y);
+    return this->vertices.size() - 1;
 }
 
-DCEL::DCEL(vector<Vertex*>& inp) {
-    int n = inp.size();
+template<class C, Winding W> void BasicDCEL<C, W>::build() {
+    int n = this->vertices.size();
     if (n < 3) {
         std::cerr << "Error: cannot create DCEL for a polygon with less than 3 vertices\n";
         return;
     }
-    this->vertices = inp;
-    for (int i = 0; i < n; i++) { // we make all the halfedge connections
+    this->halfEdges.reserve(4*n); // n inner edges, their n twins and at most n-3 diagonals with their twins
+    this->faces.reserve(2*n); // faces made by split and merging together stay below 2n
+    this->diags.reserve(n);
+    this->LDP.reserve(2*n);
 
-        HalfEdge* he1 = new HalfEdge();
-        he1->origin = this->vertices[i];
-        this->halfEdges.push_back(he1);
-        this->vertices[i]->incidentEdge = he1;
+    this->xs.resize(n);
+    this->ys.resize(n);
+    for (int i = 0; i < n; i++) {
+        this->xs[i] = this->vertices[i].x;
+        this->ys[i] = this->vertices[i].y;
     }
 
-    for (int i = 0; i < n; i++) { //we create twin half edges
+    this->halfEdges.resize(2*n);
+    this->boundary.resize(n);
+    for (int i = 0; i < n; i++) { // we make all the halfedge connections, halfedge i goes from vertex i to vertex i+1
+        this->halfEdges[i].origin = i;
+        this->vertices[i].incidentEdge = i;
+        this->boundary[i] = i;
+    }
 
-        HalfEdge* he1 = new HalfEdge();
-        he1->origin = this->vertices[(n-i+1)%n];
-        this->halfEdges.push_back(he1);
+    for (int i = 0; i < n; i++) { //we create twin half edges, halfedge n+i goes from vertex i+1 back to vertex i
+        this->halfEdges[n+i].origin = (i+1)%n;
     }
 
     for (int i = 0; i < n; i++) { //assign twins
-        this->halfEdges[i]->next = this->halfEdges[(i + 1) % n];
-        this->halfEdges[i]->twin = this->halfEdges[i + n];
-        this->halfEdges[i]->next->origin->prev = this->halfEdges[i]->twin;
-        this->halfEdges[i+n]->twin = this->halfEdges[i];
+        this->halfEdges[i].next = (i + 1) % n;
+        this->halfEdges[i].prev = (i - 1 + n) % n;
+        this->halfEdges[i].twin = n + i;
+        this->halfEdges[n+i].twin = i;
+        this->halfEdges[n+i].next = n + (i - 1 + n) % n; //assign next and prev, the twins run clockwise around the outside
+        this->halfEdges[n+i].prev = n + (i + 1) % n;
     }
 
-    for (int i = n; i < 2*n -1; i++) {
-        this->halfEdges[i]->next = this->halfEdges[i + 1]; //assign next
+    this->faces.emplace_back(); //create new face, assign respective values to it
+    for (int i = 0; i < n; i++) {
+        this->halfEdges[i].face = 0;
     }
+    this->faces[0].outerComponent = 0;
+}
+
+/// @brief Checks if a point is inside the convex polygon xs, ys, given in the winding W, or on its boundary.
+/// It binary searches the wedge around the first vertex that holds the point, so it takes O(log k) orientation tests and no divisions.
+/// @tparam C The coordinate policy of the coordinates
+/// @tparam W The winding of the polygon
+/// @param xs X-coordinates of the polygon, in a contiguous array
+/// @param ys Y-coordinates of the polygon, in a contiguous array
+/// @param k Number of vertices of the polygon, at least 3
+/// @param px X-coordinate of the point
+/// @param py Y-coordinate of the point
+/// @param inWedge Whether the point is already known to be in the wedge at the first vertex, between the rays through the second
+/// and the last vertex, like the hits of Kernels::rectHits, so that the search can start right away
+/// @return true if the point is inside the polygon or on its boundary
+template<class C = DoubleCoords, Winding W = Winding::CounterClockwise>
+bool insideConvex(const typename C::Value* xs, const typename C::Value* ys, int k, typename C::Value px, typename C::Value py, bool inWedge = false);
+
+/// @brief Relative error of the determinant of orient when it is evaluated in doubles, from Shewchuk's "Adaptive Precision
+/// Floating-Point Arithmetic and Fast Robust Geometric Predicates". If the determinant is further from 0 than this times the sum
+/// of the magnitudes of its two products, its sign is the sign of the exact determinant
+const double ORIENT_BOUND = (3.0 + 16.0 * 0x1p-53) * 0x1p-53;
+
+/// @brief Finds on which side of the line from a to b the point c is, exactly for any doubles. We evaluate the determinant
+/// (bx - ax)*(cy - ay) - (by - ay)*(cx - ax) in doubles, and only when it is within ORIENT_BOUND of 0 do we work out the sign
+/// of the exact determinant with orientExact
+/// @return A number that is positive if a, b, c turn counter-clockwise, negative if they turn clockwise and 0 if they are on one
+/// line, the rounded determinant itself when its sign is sure, so that the callers compare it with 0 like they would the determinant
+double orient(double ax, double ay, double bx, double by, double cx, double cy);
 
-    this->halfEdges[2*n - 1]->next = this->halfEdges[n];
+/// @brief The exact part of orient. The determinant is a sum of six products of coordinates, or of two when the differences of
+/// coordinates are exact, each product is split into two doubles without rounding with Dekker's product, and the doubles are added
+/// up without rounding as an expansion, Shewchuk's Grow-Expansion
+/// @return The sign of the determinant, 1, -1 or 0
+int orientExact(double ax, double ay, double bx, double by, double cx, double cy);
 
-    Face* face = new Face(); //create new face, assign respective values to it
-    this->faces.push_back(face);
-    mp[0] = face;
-    mp1[face] = 0;
+/// @brief Checks if the segments p, q and s, t have a point in common, touching and collinear overlaps included
+/// @return true if they do
+bool segmentsMeet(const Vertex& p, const Vertex& q, const Vertex& s, const Vertex& t);
 
-    HalfEdge* he = this->halfEdges[0];
-    do {
-        he->face = face;
-        he = he->next;
-    } while (he != this->halfEdges[0]);
+/// @brief The loops of algorithm1 that test many vertices against the same thing, over contiguous x and y arrays.
+/// Each one writes the indices of the vertices that pass to hits, in order, and returns how many there are.
+/// They give the same answers as signedArea, the side test of algorithm1, Vertex::insideRect and the first test of insideConvex, all exact through
+/// the orient of the coordinate policy.
+/// @tparam T Type of the coordinates, the Value of the coordinate policy
+/// @param rectHits Indices of the points inside the rectangle x1, x2, y1, y2, borders included, that are also inside the wedge at a
+/// between the rays to b and to c, which insideConvex tests first. The removedSlot points are never inside
+/// @param lineHits Indices of the points p with sign * ((p.y - ay)*(bx - ax) - (by - ay)*(p.x - ax)) < 0, the ones that are not on
+/// the side of the line a, b that algorithm1 looks for
+/// @param reflexHits Indices of the vertices of the polygon xs, ys where sign * orient of their neighbours and them is negative, the
+/// reflex vertices of a counter-clockwise polygon for sign 1 and of a clockwise one for sign -1
+template<class T> class BasicKernels {
+public:
+    int (*rectHits)(const T* xs, const T* ys, int count, T x1, T x2, T y1, T y2, T ax, T ay, T bx, T by, T cx, T cy, Id* hits);
+    int (*lineHits)(const T* xs, const T* ys, int count, T ax, T ay, T bx, T by, double sign, Id* hits);
+    int (*reflexHits)(const T* xs, const T* ys, int n, double sign, Id* hits);
+};
+
+/// @brief The kernels of doubles, the ones of DoubleCoords
+using Kernels = BasicKernels<double>;
+
+/// @brief Picks the kernels to run on
+/// @param simd Whether to use the AVX2 kernels when the CPU supports them, false always gives the scalar ones
+/// @return The kernels
+Kernels pickKernels(bool simd);
 
-    face->outerComponent = halfEdges[0];
+/// @brief The kernels algorithm1 uses, the AVX2 ones if the CPU has AVX2
+Kernels kernels = pickKernels(true);
+
+/// @brief Picks the kernels of Int32Coords, whose rectHits compares 8 coordinates at a time with AVX2 when the CPU supports it
+/// @param simd Whether to use AVX2, false always gives the scalar kernels
+/// @return The kernels
+BasicKernels<int32_t> pickInt32Kernels(bool simd);
+
+/// @brief The kernels algorithm1 uses for Int32Coords
+BasicKernels<int32_t> int32Kernels = pickInt32Kernels(true);
+
+inline double orient(double ax, double ay, double bx, double by, double cx, double cy){
+    double l = (bx - ax)*(cy - ay), r = (by - ay)*(cx - ax), det = l - r;
+    if(fabs(det) > ORIENT_BOUND * (fabs(l) + fabs(r))) return det;
+    return orientExact(ax, ay, bx, by, cx, cy); // too close to 0 to trust the rounded products
 }
 
-bool signedArea(Vertex* v0, Vertex* v1, Vertex* v2){ //calculates signed area, return true if v0 v1 v2 form reflex angle
+__attribute__((noinline)) // it is rare, so we keep it out of the callers of orient and orient small enough to inline
+int orientExact(double ax, double ay, double bx, double by, double cx, double cy){
+    if((bx == cx and by == cy) or (ax == bx and ay == by)) return 0; // two of the points are the same, algorithm1 asks that a lot
+    // a difference of doubles is 0 only for equal doubles and has their sign otherwise, so when a product has a factor that is 0,
+    // like when c is a, the sign of the other product is the sign of its factors
+    bool l0 = bx == ax or cy == ay, r0 = by == ay or cx == ax;
+    if(l0 and r0) return 0;
+    if(l0) return ((by > ay) == (cx > ax)) ? -1 : 1;
+    if(r0) return ((bx > ax) == (cy > ay)) ? 1 : -1;
 
-    if(((v1->x - v0->x)*(v2->y - v0->y) - (v2->x - v0->x)*(v1->y - v0->y)) >= 0)
-        return true;
-    return false;
+    double e[12]; // nonzero parts of the sum so far, that do not overlap, from the smallest to the biggest
+    int m = 0;
+    auto sign = [&](){ return m == 0 ? 0 : e[m-1] > 0 ? 1 : -1; }; // the biggest part has the sign of the sum
+    auto add = [&](double b){
+        int k = 0;
+        double q = b;
+        for(int i = 0; i < m; i++){ // q + e[i] as the rounded sum s and the error h, exactly
+            double s = q + e[i], bv = s - q, h = (q - (s - bv)) + (e[i] - bv);
+            q = s;
+            if(h != 0) e[k++] = h;
+        }
+        if(q != 0) e[k++] = q;
+        m = k;
+    };
+    auto split = [](double a, double& hi, double& lo){ // a = hi + lo with 26 bits each, Dekker's split, fma is a slow call without -mfma
+        double c = 134217729.0 * a; // 2^27 + 1
+        hi = c - (c - a);
+        lo = a - hi;
+    };
+    auto product = [&](double a, double b){
+        double p = a * b, ah, al, bh, bl;
+        split(a, ah, al);
+        split(b, bh, bl);
+        add(al * bl - (((p - ah * bh) - al * bh) - ah * bl)); // the rounding error of the product
+        add(p);
+    };
+    auto exactDiff = [](double a, double b){ // whether a - b is a double
+        double x = a - b, bv = a - x, av = x + bv;
+        return (a - av) + (bv - b) == 0;
+    };
+    if(exactDiff(bx, ax) and exactDiff(cy, ay) and exactDiff(by, ay) and exactDiff(cx, ax)){
+        product(bx - ax, cy - ay); // the usual case, the differences are exact and so is the determinant of two exact products
+        product(-(by - ay), cx - ax);
+        return sign();
+    }
+    product(bx, cy); // (bx - ax)*(cy - ay) - (by - ay)*(cx - ax), multiplied out, the ax*ay terms cancel
+    product(-bx, ay);
+    product(-ax, cy);
+    product(-by, cx);
+    product(ax, by);
+    product(ay, cx);
+    return sign();
 }
 
-double Vertex::intersection(Vertex* v1, Vertex* v2){ //returns x coord of intersection of v1v2 and horizontal line through vertex
-    
-    return v1->x + (this->y - v1->y) * (v2->x - v1->x) / (v2->y - v1->y);
+inline DoubleCoords::Det DoubleCoords::orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy){
+    return ::orient(ax, ay, bx, by, cx, cy);
 }
 
-bool Vertex::side(Vertex* v1, Vertex* v2, int val){ //checks if Vertex is on same side as Last[Lm] wrt v1v2 line
-    int sign; //sign of the value returned when last[lm] is evaluated on v1v2's line
-    if(val<0) sign = -1;
-    else if(val>0) sign = 1;
-    else return true;
-    if(((this->y-v1->y)*(v2->x - v1->x) - (v2->y - v1->y)*(this->x - v1->x)) * sign >= 0) return true;
-    return false;
+inline FloatCoords::Det FloatCoords::orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy){
+    return ::orient(ax, ay, bx, by, cx, cy);
 }
 
-bool Vertex::inside(Vertex* st, Vertex* ed){
-    int counter = 0; //counter of the number of lines a ray from 'this' parallel to x-axis in positive direction intersects
-    double intersect = -10000.0;
-    HalfEdge* e = st->incidentEdge, *start = e;
-    do{
-        Vertex* v1 = e->origin, *v2 = v1->next();
-        if(v1->y == v2->y) // edge case of if an edge of the face is parallel to the x-axis
-        {
-            if(this->y == v1->y){
-                if(this->x < min(v1->x, v2->x)) counter++; //vertex is to the left of this edge and intersects it
-                else if(this->x >= min(v1->x,v2->x) and this->x <= max(v1->x,v2->x)) return true; // vertex is on the line segment of the face
-            }
-            e = e->next;
-            continue;
+inline Int32Coords::Det Int32Coords::orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy){
+    return ((int64_t)bx - ax) * ((int64_t)cy - ay) - ((int64_t)by - ay) * ((int64_t)cx - ax);
+}
+
+inline Int64Coords::Det Int64Coords::orient(Value ax, Value ay, Value bx, Value by, Value cx, Value cy){
+    __int128 det = ((__int128)bx - ax) * ((__int128)cy - ay) - ((__int128)by - ay) * ((__int128)cx - ax);
+    return (det > 0) - (det < 0);
+}
+
+template<class C, Winding W> typename C::Det BasicDCEL<C, W>::turn(const Point& a, const Point& b, const Point& c){
+    if constexpr(W == Winding::CounterClockwise) return C::orient(a.x, a.y, b.x, b.y, c.x, c.y);
+    else return C::orient(a.x, a.y, c.x, c.y, b.x, b.y);
+}
+
+template<class C, Winding W> bool BasicDCEL<C, W>::signedArea(const Point& v0, const Point& v1, const Point& v2){
+    return turn(v0, v1, v2) >= 0;
+}
+
+bool segmentsMeet(const Vertex& p, const Vertex& q, const Vertex& s, const Vertex& t){
+    auto cross = [](const Vertex& o, const Vertex& a, const Vertex& b){ return orient(o.x, o.y, a.x, a.y, b.x, b.y); };
+    if(max(s.x, t.x) < min(p.x, q.x) or min(s.x, t.x) > max(p.x, q.x) or max(s.y, t.y) < min(p.y, q.y) or min(s.y, t.y) > max(p.y, q.y)) return false;
+    double d1 = cross(p, q, s), d2 = cross(p, q, t), d3 = cross(s, t, p), d4 = cross(s, t, q);
+    return !(((d1 > 0 and d2 > 0) or (d1 < 0 and d2 < 0)) or ((d3 > 0 and d4 > 0) or (d3 < 0 and d4 < 0)));
+}
+
+template<class C, Winding W>
+bool insideConvex(const typename C::Value* xs, const typename C::Value* ys, int k, typename C::Value px, typename C::Value py, bool inWedge){
+    auto turn = [&](int a, int b){ // sign of the turn from xs[a],ys[a] to xs[b],ys[b] to the point, a and b swap places for clockwise
+        if constexpr(W == Winding::CounterClockwise) return C::orient(xs[a], ys[a], xs[b], ys[b], px, py);
+        else return C::orient(xs[b], ys[b], xs[a], ys[a], px, py);
+    };
+    if(!inWedge and (turn(0, 1) < 0 or turn(0, k-1) > 0)) return false; // the point is outside of the wedge at the first vertex
+
+    int lo = 1, hi = k-2; // we binary search the last vertex i such that the point is not to the right of the ray from the first vertex through i
+    while(lo < hi){
+        int mid = (lo + hi + 1) / 2;
+        if(turn(0, mid) >= 0) lo = mid;
+        else hi = mid - 1;
+    }
+    return turn(lo, lo+1) >= 0; // the point is in the triangle 0, lo, lo+1 unless it is beyond the edge lo, lo+1
+}
+
+// The scalar kernels are templates on the coordinate policy, they are the kernels of every policy but DoubleCoords on a CPU with AVX2
+
+template<class C> using ValueOf = typename C::Value;
+
+template<class C> int rectHitsScalar(const ValueOf<C>* xs, const ValueOf<C>* ys, int count, ValueOf<C> x1, ValueOf<C> x2, ValueOf<C> y1, ValueOf<C> y2,
+                                     ValueOf<C> ax, ValueOf<C> ay, ValueOf<C> bx, ValueOf<C> by, ValueOf<C> cx, ValueOf<C> cy, Id* hits){
+    int h = 0;
+    for(int i = 0; i < count; i++){
+        hits[h] = i; // we always write and only move on for a hit
+        h += xs[i] >= x1 and xs[i] <= x2 and ys[i] >= y1 and ys[i] <= y2 and
+             C::orient(ax, ay, bx, by, xs[i], ys[i]) >= 0 and C::orient(ax, ay, cx, cy, xs[i], ys[i]) <= 0;
+    }
+    return h;
+}
+
+template<class C> int lineHitsScalar(const ValueOf<C>* xs, const ValueOf<C>* ys, int count, ValueOf<C> ax, ValueOf<C> ay, ValueOf<C> bx, ValueOf<C> by,
+                                     double sign, Id* hits){
+    int h = 0;
+    for(int i = 0; i < count; i++){
+        hits[h] = i;
+        h += C::orient(ax, ay, bx, by, xs[i], ys[i]) * sign < 0;
+    }
+    return h;
+}
+
+template<class C> int reflexHitsScalar(const ValueOf<C>* xs, const ValueOf<C>* ys, int n, double sign, Id* hits){
+    int h = 0;
+    for(int i = 0; i < n; i++){
+        int a = i ? i-1 : n-1, b = i+1 < n ? i+1 : 0;
+        hits[h] = i;
+        h += C::orient(xs[a], ys[a], xs[i], ys[i], xs[b], ys[b]) * sign < 0;
+    }
+    return h;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// The AVX2 kernels compare 4 doubles at a time and turn the comparison into a 4 bit mask, whose set bits are the hits.
+// They evaluate the determinant of orient in doubles and use its sign where ORIENT_BOUND says it is right, the other lanes
+// are done again with orient itself, so they give the same answers as the scalar kernels
+
+/// @brief Appends the indices of the set bits of a 4 bit mask
+/// @param mask The mask
+/// @param base Index of bit 0
+/// @param hits Where the indices go
+/// @param h Number of hits so far, it is moved past the new ones
+inline void appendMask(int mask, int base, Id* hits, int& h){
+    while(mask){
+        hits[h++] = base + __builtin_ctz(mask);
+        mask &= mask - 1;
+    }
+}
+
+/// @brief Loads the doubles from p up to end, at most 4 of them, the lanes past end are 0
+/// @param p Where to start
+/// @param left Number of doubles left from p, the lanes from left on are not read
+/// @return The loaded lanes
+__attribute__((target("avx2")))
+inline __m256d loadTail(const double* p, int left){
+    __m256i lanes = _mm256_set_epi64x(3, 2, 1, 0);
+    return _mm256_maskload_pd(p, _mm256_cmpgt_epi64(_mm256_set1_epi64x(left), lanes));
+}
+
+/// @brief Finds the lanes where the sign of the determinant l - r of orient cannot be trusted, as orient does
+/// @param l The first product of each lane
+/// @param r The second product of each lane
+/// @param det l - r
+/// @return A 4 bit mask of the lanes to do again with orient, NaN lanes are in it too
+__attribute__((target("avx2")))
+inline int unsureLanes(__m256d l, __m256d r, __m256d det){
+    __m256d abs = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL)); // clears the sign bit
+    __m256d bound = _mm256_mul_pd(_mm256_set1_pd(ORIENT_BOUND), _mm256_add_pd(_mm256_and_pd(l, abs), _mm256_and_pd(r, abs)));
+    return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(det, abs), bound, _CMP_NGT_UQ));
+}
+
+__attribute__((target("avx2")))
+int rectHitsAVX2(const double* xs, const double* ys, int count, double x1, double x2, double y1, double y2,
+                 double ax, double ay, double bx, double by, double cx, double cy, Id* hits){
+    __m256d X1 = _mm256_set1_pd(x1), X2 = _mm256_set1_pd(x2), Y1 = _mm256_set1_pd(y1), Y2 = _mm256_set1_pd(y2);
+    __m256d AX = _mm256_set1_pd(ax), AY = _mm256_set1_pd(ay), Z = _mm256_setzero_pd();
+    __m256d BDX = _mm256_set1_pd(bx - ax), BDY = _mm256_set1_pd(by - ay), CDX = _mm256_set1_pd(cx - ax), CDY = _mm256_set1_pd(cy - ay);
+    int h = 0;
+    for(int i = 0; i < count; i += 4){ // the last block is loaded with a mask and its lanes past count are dropped from the hits
+        bool full = i + 4 <= count;
+        __m256d x = full ? _mm256_loadu_pd(xs + i) : loadTail(xs + i, count - i), y = full ? _mm256_loadu_pd(ys + i) : loadTail(ys + i, count - i);
+        __m256d in = _mm256_and_pd(_mm256_and_pd(_mm256_cmp_pd(x, X1, _CMP_GE_OQ), _mm256_cmp_pd(x, X2, _CMP_LE_OQ)),
+                                   _mm256_and_pd(_mm256_cmp_pd(y, Y1, _CMP_GE_OQ), _mm256_cmp_pd(y, Y2, _CMP_LE_OQ))); // ordered compares are false for NaN
+        int mask = _mm256_movemask_pd(in) & (full ? 15 : (1 << (count - i)) - 1);
+        if(!mask) continue; // most blocks have nothing in the rectangle, we skip the wedge for them
+        __m256d px = _mm256_sub_pd(x, AX), py = _mm256_sub_pd(y, AY);
+        __m256d bl = _mm256_mul_pd(BDX, py), br = _mm256_mul_pd(px, BDY), b = _mm256_sub_pd(bl, br);
+        __m256d cl = _mm256_mul_pd(CDX, py), cr = _mm256_mul_pd(px, CDY), c = _mm256_sub_pd(cl, cr);
+        int unsure = (unsureLanes(bl, br, b) | unsureLanes(cl, cr, c)) & mask;
+        mask &= _mm256_movemask_pd(_mm256_and_pd(_mm256_cmp_pd(b, Z, _CMP_GE_OQ), _mm256_cmp_pd(c, Z, _CMP_LE_OQ)));
+        for(; unsure; unsure &= unsure - 1){ // points almost on a ray of the wedge
+            int j = __builtin_ctz(unsure);
+            bool hit = orient(ax, ay, bx, by, xs[i+j], ys[i+j]) >= 0 and orient(ax, ay, cx, cy, xs[i+j], ys[i+j]) <= 0;
+            mask = hit ? mask | 1 << j : mask & ~(1 << j);
         }
-        intersect = this->intersection(v1,v2);
-        if(this->x == intersect) return true; // another case where the vertex is on the line segment
-        if(max(v1->y,v2->y) >= this->y and min(v1->y,v2->y) < this->y and this->x < intersect) // case where the ray crosses the line-segment
-        {
-            counter++;
+        appendMask(mask, i, hits, h);
+    }
+    return h;
+}
+
+__attribute__((target("avx2")))
+int lineHitsAVX2(const double* xs, const double* ys, int count, double ax, double ay, double bx, double by, double sign, Id* hits){
+    __m256d AX = _mm256_set1_pd(ax), AY = _mm256_set1_pd(ay), DX = _mm256_set1_pd(bx - ax), DY = _mm256_set1_pd(by - ay);
+    __m256d S = _mm256_set1_pd(sign), Z = _mm256_setzero_pd();
+    int h = 0;
+    for(int i = 0; i < count; i += 4){
+        bool full = i + 4 <= count;
+        __m256d x = full ? _mm256_loadu_pd(xs + i) : loadTail(xs + i, count - i), y = full ? _mm256_loadu_pd(ys + i) : loadTail(ys + i, count - i);
+        __m256d l = _mm256_mul_pd(_mm256_sub_pd(y, AY), DX), r = _mm256_mul_pd(DY, _mm256_sub_pd(x, AX)), d = _mm256_sub_pd(l, r);
+        int valid = full ? 15 : (1 << (count - i)) - 1;
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_mul_pd(d, S), Z, _CMP_LT_OQ)) & valid;
+        for(int unsure = unsureLanes(l, r, d) & valid; unsure; unsure &= unsure - 1){ // points almost on the line
+            int j = __builtin_ctz(unsure);
+            mask = orient(ax, ay, bx, by, xs[i+j], ys[i+j]) * sign < 0 ? mask | 1 << j : mask & ~(1 << j);
         }
-        e = e->next;
-    }while(e->origin != ed);
+        appendMask(mask, i, hits, h);
+    }
+    return h;
+}
 
-    Vertex* v1 = st, *v2 = ed;
-    if(v1->y == v2->y and this->y == v1->y) // for the final edge of the face
-    {
-        if(this->x < min(v1->x, v2->x)) counter++;
-        else if(this->x >= min(v1->x,v2->x) and this->x <= max(v1->x,v2->x)) return true;
+__attribute__((target("avx2")))
+int reflexHitsAVX2(const double* xs, const double* ys, int n, double sign, Id* hits){
+    if(n < 6) return reflexHitsScalar<DoubleCoords>(xs, ys, n, sign, hits);
+    int h = 0;
+    auto one = [&](int i){ // the first and the last vertex wrap around, we do them on their own
+        int a = i ? i-1 : n-1, b = i+1 < n ? i+1 : 0;
+        if(orient(xs[a], ys[a], xs[i], ys[i], xs[b], ys[b]) * sign < 0) hits[h++] = i;
+    };
+    one(0);
+    int i = 1;
+    __m256d S = _mm256_set1_pd(sign), Z = _mm256_setzero_pd();
+    for(; i + 4 <= n - 1; i += 4){
+        __m256d ax = _mm256_loadu_pd(xs + i - 1), ay = _mm256_loadu_pd(ys + i - 1);
+        __m256d vx = _mm256_loadu_pd(xs + i), vy = _mm256_loadu_pd(ys + i);
+        __m256d bx = _mm256_loadu_pd(xs + i + 1), by = _mm256_loadu_pd(ys + i + 1);
+        __m256d l = _mm256_mul_pd(_mm256_sub_pd(vx, ax), _mm256_sub_pd(by, ay)), r = _mm256_mul_pd(_mm256_sub_pd(bx, ax), _mm256_sub_pd(vy, ay));
+        __m256d area = _mm256_sub_pd(l, r);
+        int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_mul_pd(area, S), Z, _CMP_LT_OQ));
+        for(int unsure = unsureLanes(l, r, area); unsure; unsure &= unsure - 1){ // vertices almost on the line of their neighbours
+            int j = __builtin_ctz(unsure);
+            mask = orient(xs[i+j-1], ys[i+j-1], xs[i+j], ys[i+j], xs[i+j+1], ys[i+j+1]) * sign < 0 ? mask | 1 << j : mask & ~(1 << j);
+        }
+        appendMask(mask, i, hits, h);
     }
-    intersect = this->intersection(v1,v2);
-    if(this->x == intersect) return true;
+    for(; i < n; i++) one(i);
+    return h;
+}
 
-    if(max(v1->y,v2->y) >= this->y and min(v1->y,v2->y) < this->y and this->x < intersect){
-        counter++;
+__attribute__((target("avx2")))
+int rectHitsInt32AVX2(const int32_t* xs, const int32_t* ys, int count, int32_t x1, int32_t x2, int32_t y1, int32_t y2,
+                      int32_t ax, int32_t ay, int32_t bx, int32_t by, int32_t cx, int32_t cy, Id* hits){
+    // there is only a greater than for integers, so we find the lanes outside of the rectangle. The removedSlot is above every x2
+    __m256i X1 = _mm256_set1_epi32(x1), X2 = _mm256_set1_epi32(x2), Y1 = _mm256_set1_epi32(y1), Y2 = _mm256_set1_epi32(y2);
+    int h = 0, i = 0;
+    auto wedge = [&](int j){ // the exact test of the hits of the rectangle, which are few
+        hits[h] = j;
+        h += Int32Coords::orient(ax, ay, bx, by, xs[j], ys[j]) >= 0 and Int32Coords::orient(ax, ay, cx, cy, xs[j], ys[j]) <= 0;
+    };
+    for(; i + 8 <= count; i += 8){
+        __m256i x = _mm256_loadu_si256((const __m256i*)(xs + i)), y = _mm256_loadu_si256((const __m256i*)(ys + i));
+        __m256i out = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(X1, x), _mm256_cmpgt_epi32(x, X2)),
+                                      _mm256_or_si256(_mm256_cmpgt_epi32(Y1, y), _mm256_cmpgt_epi32(y, Y2)));
+        for(int mask = ~_mm256_movemask_ps(_mm256_castsi256_ps(out)) & 255; mask; mask &= mask - 1) wedge(i + __builtin_ctz(mask));
     }
-    return (counter%2 == 1);
+    for(; i < count; i++) if(xs[i] >= x1 and xs[i] <= x2 and ys[i] >= y1 and ys[i] <= y2) wedge(i);
+    return h;
+}
+#endif
+
+Kernels pickKernels(bool simd){
+#if defined(__x86_64__) || defined(__i386__)
+    if(simd and __builtin_cpu_supports("avx2")) return {rectHitsAVX2, lineHitsAVX2, reflexHitsAVX2};
+#endif
+    return {rectHitsScalar<DoubleCoords>, lineHitsScalar<DoubleCoords>, reflexHitsScalar<DoubleCoords>};
+}
+
+const Kernels& DoubleCoords::kernels(){
+    return ::kernels; // bench --scalar may swap them
+}
+
+const BasicKernels<float>& FloatCoords::kernels(){
+    static const BasicKernels<float> scalar = {rectHitsScalar<FloatCoords>, lineHitsScalar<FloatCoords>, reflexHitsScalar<FloatCoords>};
+    return scalar;
+}
+
+BasicKernels<int32_t> pickInt32Kernels(bool simd){
+#if defined(__x86_64__) || defined(__i386__)
+    if(simd and __builtin_cpu_supports("avx2")) return {rectHitsInt32AVX2, lineHitsScalar<Int32Coords>, reflexHitsScalar<Int32Coords>};
+#endif
+    return {rectHitsScalar<Int32Coords>, lineHitsScalar<Int32Coords>, reflexHitsScalar<Int32Coords>};
+}
+
+const BasicKernels<int32_t>& Int32Coords::kernels(){
+    return ::int32Kernels;
+}
+
+const BasicKernels<int64_t>& Int64Coords::kernels(){
+    static const BasicKernels<int64_t> scalar = {rectHitsScalar<Int64Coords>, lineHitsScalar<Int64Coords>, reflexHitsScalar<Int64Coords>};
+    return scalar;
 }
 
-bool Vertex::insideRect(double x1, double x2, double y1, double y2){
+template<class T> bool BasicVertex<T>::insideRect(T x1, T x2, T y1, T y2) const{
     if(this->x >= x1 and this->x <= x2 and this->y >= y1 and this->y <= y2) return true;
     return false;
 }
 
-Vertex* Vertex::next(){
-    return this->incidentEdge->next->origin;
+template<class C, Winding W> Id BasicDCEL<C, W>::next(Id v) const{
+    return this->halfEdges[this->halfEdges[this->vertices[v].incidentEdge].next].origin;
+}
+
+template<class C, Winding W> bool BasicDCEL<C, W>::isNotch(Id v) const{
+    return !signedArea(this->vertices[this->before(v)], this->vertices[v], this->vertices[this->next(v)]);
+}
+
+template<class T> T removedSlot(){
+    if constexpr(is_floating_point_v<T>) return numeric_limits<T>::quiet_NaN();
+    else return numeric_limits<T>::max();
+}
+
+template<class T> void BasicNotchGrid<T>::build(const vector<BasicVertex<T>>& P, const vector<Id>& notches){
+    int r = notches.size();
+    this->size = r;
+    this->pos.assign(P.size(), NIL);
+    this->items.resize(r);
+    this->itemX.resize(r);
+    this->itemY.resize(r);
+    if(r == 0){ // a convex polygon has no notches, we still keep one empty cell so that queries need no special case
+        this->minX = this->minY = 0;
+        this->cellW = this->cellH = 1;
+        this->cols = this->rows = 1;
+        this->cellStart.assign(2, 0);
+        this->cellCount.assign(1, 0);
+        return;
+    }
+    double maxX = P[notches[0]].x, maxY = P[notches[0]].y;
+    this->minX = maxX;
+    this->minY = maxY;
+    for(Id v: notches){ // the grid only has to cover the notches, queries outside of it get clamped to the border cells
+        this->minX = min<double>(this->minX, P[v].x);
+        this->minY = min<double>(this->minY, P[v].y);
+        maxX = max<double>(maxX, P[v].x);
+        maxY = max<double>(maxY, P[v].y);
+    }
+    double w = maxX - this->minX, h = maxY - this->minY;
+    double cells = max(1.0, r / 2.0);
+    if(w > 0 and h > 0){ // we keep the cells about square
+        this->cols = max(1, min(r, (int)ceil(sqrt(cells * w / h))));
+        this->rows = max(1, min(r, (int)ceil(cells / this->cols)));
+    }
+    else{ // all the notches are on one horizontal or vertical line
+        this->cols = w > 0 ? (int)ceil(cells) : 1;
+        this->rows = h > 0 ? (int)ceil(cells) : 1;
+    }
+    this->cellW = w > 0 ? w / this->cols : 1;
+    this->cellH = h > 0 ? h / this->rows : 1;
+
+    int c = this->cols * this->rows;
+    this->cellStart.assign(c + 1, 0);
+    this->cellCount.assign(c, 0);
+    for(Id v: notches) this->cellCount[this->row(P[v].y) * this->cols + this->col(P[v].x)]++; // counting sort of the notches by cell
+    for(int i = 0; i < c; i++) this->cellStart[i+1] = this->cellStart[i] + this->cellCount[i];
+    vector<Id> fill(this->cellStart.begin(), this->cellStart.end() - 1);
+    for(Id v: notches){
+        Id at = fill[this->row(P[v].y) * this->cols + this->col(P[v].x)]++;
+        this->items[at] = v;
+        this->itemX[at] = P[v].x;
+        this->itemY[at] = P[v].y;
+        this->pos[v] = at;
+    }
+}
+
+template<class T> void BasicNotchGrid<T>::remove(Id v){
+    Id at = this->pos[v];
+    if(at == NIL) return;
+    this->size--;
+    this->itemX[at] = this->itemY[at] = removedSlot<T>(); // the slot stays where it is and no rectangle test passes it any more
+    this->pos[v] = NIL;
+}
+
+template<class T> int BasicNotchGrid<T>::col(double x) const{
+    int c = (x - this->minX) / this->cellW;
+    return max(0, min(this->cols - 1, c));
 }
 
-void DCEL::algorithm1()
+template<class T> int BasicNotchGrid<T>::row(double y) const{
+    int r = (y - this->minY) / this->cellH;
+    return max(0, min(this->rows - 1, r));
+}
+
+template<class C, Winding W> bool BasicDCEL<C, W>::algorithm1(Id start, const atomic<Id>* bound, uint64_t budget)
 {
     int n = this->vertices.size();
-    vector<Vertex*> v = this->vertices;
-    vector<vector<Vertex*>> L(n*100);
-    L[0].push_back(v[0]); // we push the first vertex into L[0]
-    int m = 1;
+    METRIC(double st = steadySeconds(); this->metrics.polygons = 1; this->metrics.vertices = n);
+    const vector<Point>& P = this->vertices;
+    const BasicKernels<Value>& kernels = C::kernels();
+    vector<Id> v;
+    vector<Id> Lm; // the potential new polygon L[m]. Only L[m-1].back() is ever read from the earlier ones, so we keep that in prevLast instead of a table of every L
+    vector<Value> Lx, Ly; // the coordinates of L[m] in a contiguous array each, for the point in convex polygon test and the kernels
+    vector<Id> hits(2*n); // the output of the kernels, the hits of a row of cells and then those of L[m], each of them at most n
+    Id prevLast = start; // we start from the start vertex, as if it was the last element of L[0]
+
+    // LPVS is kept for the whole run as a grid over the notches of face 0. Only notches can lie inside a convex candidate,
+    // and a split only ever removes the vertices it cuts off and can turn its two ends convex, so we never rebuild it
+    // algorithm1 starts on the polygon as build() made it, so the neighbours of vertex i are i-1 and i+1 and we can classify them all at once
+    vector<Id> notches(n);
+    notches.resize(kernels.reflexHits(this->xs.data(), this->ys.data(), n, W == Winding::CounterClockwise ? 1.0 : -1.0, notches.data()));
+    this->LPVS.build(P, notches);
+    BasicNotchGrid<Value>& grid = this->LPVS;
+    this->mark.assign(n, 0); // mark[v] == stamp tells us in O(1) that v is part of the current L[m]
+    uint32_t stamp = 0;
+    uint64_t work = 0;
+
+    // a start fails when its candidate collapses to two vertices, and it fails the same way as long as the links of face 0 along its greedy
+    // chain and the notches that cut its candidate are the same: the other notches were never inside it, and the grid keeps their order.
+    // Trying it again anyway made spirals quadratic, every round of face 0 cuts only a few pieces off. So the starts that may not fail wait in
+    // pending in the order of face 0, which is the order of their ids as a split only cuts a run of it off, and a failed start goes back to
+    // pending once a vertex it watches changes
+    vector<uint64_t>& pending = this->pending;
+    vector<uint64_t>& words = this->pendingWords;
+    pending.assign((n + 63) / 64, 0);
+    words.assign((pending.size() + 63) / 64, 0);
+    Id waiting = 0;
+    auto wait = [&](Id x){
+        if(pending[x / 64] >> x % 64 & 1) return;
+        pending[x / 64] |= 1ull << x % 64;
+        words[x / 4096] |= 1ull << x / 64 % 64;
+        waiting++;
+    };
+    auto drop = [&](Id x){
+        if(!(pending[x / 64] >> x % 64 & 1)) return;
+        pending[x / 64] &= ~(1ull << x % 64);
+        if(!pending[x / 64]) words[x / 4096] &= ~(1ull << x / 64 % 64);
+        waiting--;
+    };
+    auto from = [&](Id x) -> Id { // the first pending start from x on in the order of the ids, NIL if there is none
+        uint64_t bits = pending[x / 64] & ~0ull << x % 64;
+        if(bits) return x / 64 * 64 + __builtin_ctzll(bits);
+        size_t w = x / 64 + 1;
+        for(size_t k = w / 64; k < words.size(); k++){
+            uint64_t mask = k == w / 64 ? words[k] & ~0ull << w % 64 : words[k];
+            if(mask){
+                size_t at = k * 64 + __builtin_ctzll(mask);
+                return at * 64 + __builtin_ctzll(pending[at]);
+            }
+        }
+        return NIL;
+    };
+    for(Id j = 0; j < (Id)n; j++) wait(j);
+    this->failed.assign(n, 0);
+    this->watchHead.assign(n, NIL);
+    this->watches.clear();
+    vector<Id> cuts; // the notches that cut the current L[m], or collapsed it
+    auto watch = [&](Id x){
+        this->watches.push_back({v[0], stamp, this->watchHead[x]});
+        this->watchHead[x] = this->watches.size() - 1;
+    };
+    auto retry = [&](Id x){ // the link of face 0 leaving x changed, or x stopped being a notch
+        for(Id w = this->watchHead[x]; w != NIL; w = this->watches[w].next){
+            const StartWatch& entry = this->watches[w];
+            if(this->failed[entry.start] != entry.stamp) continue; // the start was tried again since, or cut off
+            this->failed[entry.start] = 0;
+            wait(entry.start);
+        }
+        this->watchHead[x] = NIL;
+    };
+    // a notch strictly inside the triangle of the first three vertices of L[m] is inside every candidate that starts with them, and the backtrack
+    // at it keeps only the first two: the chain turns one way around v[0] by less than half a turn, so v[2] and every vertex after it are on the
+    // other side of the line from v[0] through the notch than v[1]. So once a greedy chain gets long we look for one, and fail at once if there is
+    // one. A short chain costs less than the query, and the notches that cut it find that witness as well
+    auto inFirst = [&](Id V){
+        return turn(P[v[0]], P[v[1]], P[V]) > 0 and turn(P[v[1]], P[v[2]], P[V]) > 0 and turn(P[v[2]], P[v[0]], P[V]) > 0;
+    };
+    auto firstCut = [&]() -> Id {
+        Value x1 = min({Lx[0], Lx[1], Lx[2]}), x2 = max({Lx[0], Lx[1], Lx[2]}), y1 = min({Ly[0], Ly[1], Ly[2]}), y2 = max({Ly[0], Ly[1], Ly[2]});
+        int cx1 = grid.col(x1), cx2 = grid.col(x2);
+        int first = W == Winding::CounterClockwise ? 1 : 2, second = 3 - first;
+        for(int cy = grid.row(y1); cy <= grid.row(y2); cy++){
+            Id from = grid.cellStart[cy * grid.cols + cx1], to = grid.cellStart[cy * grid.cols + cx2 + 1];
+            int h = kernels.rectHits(grid.itemX.data() + from, grid.itemY.data() + from, to - from, x1, x2, y1, y2,
+                                     Lx[0], Ly[0], Lx[first], Ly[first], Lx[second], Ly[second], hits.data());
+            work += to - from;
+            METRIC(this->metrics.rectTests += to - from; this->metrics.rectRejects += to - from - h);
+            for(int q = 0; q < h; q++) if(inFirst(grid.items[from + hits[q]])) return grid.items[from + hits[q]];
+        }
+        return NIL;
+    };
+    METRIC(this->metrics.notches = notches.size(); this->metrics.setupTime = steadySeconds() - st);
+
     while(n > 3){
+        // we give up when the budget is spent, or when we cannot beat the bound: every notch left on face 0 needs a diagonal at it
+        // before face 0 is convex, and a diagonal has two ends, so this is a lower bound on the number of diagonals this run ends up with
+        if(work > budget or (bound and this->diags.size() + (grid.size + 1) / 2 > bound->load(memory_order_relaxed))){
+            METRIC(this->metrics.algorithm1Time = steadySeconds() - st);
+            return false;
+        }
+        if(waiting){ // we go on round face 0 from prevLast, past the starts that are known to fail
+            Id at = from(prevLast);
+            prevLast = at != NIL ? at : from(0);
+        }
+        METRIC(this->metrics.iterations++; this->metrics.lpvsTotal += grid.size; this->metrics.lpvsMax = max<uint64_t>(this->metrics.lpvsMax, grid.size));
         v.clear();
-        v.push_back(L[m-1].back()); 
-        v.push_back(v[0]->next());
-        L[m].push_back(v[0]); //L[m] contains the potential new polygon. We add the last element of L[m-1] as the first element of L[m]
-        L[m].push_back(v[1]);
+        Lm.clear();
+        Lx.clear();
+        Ly.clear();
+        cuts.clear();
+        stamp++;
+        v.push_back(prevLast); 
+        v.push_back(this->next(v[0]));
+        Lm.push_back(v[0]); //L[m] contains the potential new polygon. We add the last element of L[m-1] as the first element of L[m]
+        Lm.push_back(v[1]);
+        this->mark[v[0]] = this->mark[v[1]] = stamp;
+        for(int j = 0; j < 2; j++){
+            Lx.push_back(P[v[j]].x);
+            Ly.push_back(P[v[j]].y);
+        }
         
         int i = 1;
-        v.push_back(v[i]->next());  // we greedily add points to v as long as it does not create a notch
-        while(L[m].size() < n and 
-                signedArea(v[i-1], v[i], v[i+1]) and 
-                    signedArea(v[i], v[i+1], v[0]) and 
-                        signedArea(v[i+1], v[0], v[1])) // we check if the addition of the i+1th point creates a notch
+        Id witness = NIL;
+        v.push_back(this->next(v[i]));  // we greedily add points to v as long as it does not create a notch
+        while(witness == NIL and (int)Lm.size() < n and 
+                signedArea(P[v[i-1]], P[v[i]], P[v[i+1]]) and 
+                    signedArea(P[v[i]], P[v[i+1]], P[v[0]]) and 
+                        signedArea(P[v[i+1]], P[v[0]], P[v[1]])) // we check if the addition of the i+1th point creates a notch
         {
-            L[m].push_back(v[i+1]);
+            Lm.push_back(v[i+1]);
+            Lx.push_back(P[v[i+1]].x);
+            Ly.push_back(P[v[i+1]].y);
+            this->mark[v[i+1]] = stamp;
+            work++;
             i++;
-            v.push_back(v[i]->next());        
+            v.push_back(this->next(v[i]));        
+            if(i == 8 and (witness = firstCut()) != NIL){
+                METRIC(this->metrics.backtracks++);
+                Lm.resize(2);
+                Lx.resize(2);
+                Ly.resize(2);
+            }
         }
 
-        if(L[m].size() != n)
+        if(witness == NIL and (int)Lm.size() != n)
         {
-            queue<Vertex*> LPVS;    //list that contains all elements in the undecomposed polygon that arent in L[m]
-            HalfEdge* e = this->faces[0]->outerComponent, *start = this->faces[0]->outerComponent;
-            Vertex* vertice;
-            do{
-                vertice = e->origin;
-                bool check = false;
-                for(auto j: L[m]){
-                    if(j==vertice){
-                        check = true;
-                        break;
-                    }
+            Value x1,x2,y1,y2;
+            int cx1,cx2,cy1,cy2;
+            auto bounds = [&](){ // we calculate the boundaries of the rectangle here, and the range of cells of the grid it covers
+                x1=x2=P[Lm[0]].x;
+                y1=y2=P[Lm[0]].y;
+                for(auto vertice: Lm){
+                    x1 = min(x1,P[vertice].x);
+                    x2 = max(x2,P[vertice].x);
+                    y1 = min(y1,P[vertice].y);
+                    y2 = max(y2,P[vertice].y);
                 }
-                if(!check) LPVS.push(vertice);
-                e = e->next;
-            }while(e != start);
+                cx1 = grid.col(x1), cx2 = grid.col(x2);
+                cy1 = grid.row(y1), cy2 = grid.row(y2);
+            };
+            bounds();
 
-            while(LPVS.size()>0 and L[m].size()>2) //loop until LPVS is empty
-            {
-                double x1=1e5,x2=-1e5,y1=1e5,y2=-1e5; // we calculate the boundaries of the rectangle here
-                for(auto vertice: L[m]){
-                    x1 = min(x1,vertice->x);
-                    x2 = max(x2,vertice->x);
-                    y1 = min(y1,vertice->y);
-                    y2 = max(y2,vertice->y);
-                }
-                bool backward = false;
+            // for every notch in a cell that the rectangle covers we check if it is inside the rectangle, if it is, we check if it is inside the polygon.
+            // The cells of a row are next to each other in the grid, so we filter a run of cells of a row against the rectangle and the wedge at the first
+            // vertex of L[m] in one go. The slots of removed notches hold removedSlot and never pass. A backtrack only shrinks L[m] and its rectangle, so
+            // every notch of the new one passed the filter of the old one. We test the hits again and carry on with the smaller range.
+            // The wedge of rectHits turns counter-clockwise from its first ray, so for a clockwise polygon its two rays swap places
+            bool collapsed = false;
+            auto scan = [&](int cy, int ca, int cb){ // the cells ca to cb of row cy, as far as they are under the rectangle
+                ca = max(ca, cx1);
+                cb = min(cb, cx2);
+                if(collapsed or Lm.size() <= 2 or cy < cy1 or cy > cy2 or ca > cb) return;
+                Id from = grid.cellStart[cy * grid.cols + ca], to = grid.cellStart[cy * grid.cols + cb + 1];
+                int end = Lm.size() - 1;
+                int first = W == Winding::CounterClockwise ? 1 : end, second = W == Winding::CounterClockwise ? end : 1;
+                int h = kernels.rectHits(grid.itemX.data() + from, grid.itemY.data() + from, to - from, x1, x2, y1, y2,
+                                         Lx[0], Ly[0], Lx[first], Ly[first], Lx[second], Ly[second], hits.data());
+                work += to - from;
+                METRIC(this->metrics.rectTests += to - from; this->metrics.rectRejects += to - from - h);
+                bool inWedge = true; // the hits are in the wedge at the first vertex of L[m] until a backtrack changes L[m]
+                for(int q = 0; q < h and !collapsed and Lm.size() > 2; q++)
+                {
+                    Id V = grid.items[from + hits[q]];
+                    if(this->mark[V] == stamp) continue;
+                    if(!P[V].insideRect(x1,x2,y1,y2)) continue;
+                    METRIC(this->metrics.insideTests++);
+                    if(!insideConvex<C, W>(Lx.data(), Ly.data(), Lm.size(), P[V].x, P[V].y, inWedge)) continue; // L[m] is convex, so we do not need a ray cast
 
-                while(!backward and LPVS.size()>0){
-                    Vertex* V;
-                    while(true) // for every point in LPVS we check if it is inside the recatangle, if it is, we check if it is inside the polygon
-                    {
+                    // V is inside our current polygon so we need to remove vertices
+                    const Point& last = P[Lm.back()];
+                    // the side of last[Lm] wrt line v0-V, exactly, only a last[Lm] on that line collapses L[m]. Being on the same side
+                    // does not depend on the winding, so this is orient of C itself
+                    auto val = C::orient(P[v[0]].x, P[v[0]].y, P[V].x, P[V].y, last.x, last.y);
+                    cuts.push_back(V);
+                    if(witness == NIL and v.size() > 3 and inFirst(V)) witness = V;
 
-                        if(LPVS.size()==0) break;
-                        V = LPVS.front();
-                        bool isInside = V->insideRect(x1,x2,y1,y2);
-                        if(isInside) break;
-                        else LPVS.pop();
-                    }
-                    if(LPVS.size()>0)
+                    if(val==0)
                     {
-                        Vertex* fi = L[m].front(), *la = L[m].back();
-                        if(V->inside(fi, la)) // V is inside our current polygon so we need to remove vertices
-                        {
-                            Vertex* last = L[m].back();
-                            int val = (last->y-v[0]->y)*(V->x - v[0]->x) - (V->y - v[0]->y)*(last->x - v[0]->x);
-                            
-                            if(val==0)
-                            {
-                                L[m] = {L[m].front(), L[m].front()->next()};
-                                break;
-                            }
-                            else{
-                                vector<Vertex*> VTR; // list of vertices we want in Lm
-                                for(auto vertice: L[m]){
-                                    if(vertice == L[m].front()){
-                                        VTR.push_back(vertice);
-                                        continue;
-                                    }
-                                    if(!vertice->side(v[0], V, val)) // we check if vertice is on same side as last[Lm] wrt line v0-V
-                                        VTR.push_back(vertice); //if no, we push it to VTR
-                                }
-                                L[m] = VTR; //reassign L[m] with elements not on the same side of last[Lm]
-                            }
-                            backward = true; //asks us to backtrack the vertices of L[m]
-                        }
-                        LPVS.pop();
+                        METRIC(this->metrics.collapses++);
+                        Lm.resize(2);
+                        Lm[1] = this->next(Lm.front());
+                        collapsed = true;
+                        break;
+                    }
+                    // we keep the first vertex and the vertices that are not on the same side as last[Lm] wrt line v0-V, with the sign of
+                    // val and never its truncation, and compact them in Lm in place, in their original order
+                    work += Lm.size();
+                    int keep = kernels.lineHits(Lx.data() + 1, Ly.data() + 1, Lm.size() - 1, P[v[0]].x, P[v[0]].y, P[V].x, P[V].y, val < 0 ? -1.0 : 1.0, hits.data() + h);
+                    size_t k = 1;
+                    for(int j = 0; j < keep; j++){
+                        Id at = 1 + hits[h + j];
+                        Lx[k] = Lx[at];
+                        Ly[k] = Ly[at];
+                        Lm[k++] = Lm[at];
+                    }
+                    METRIC(this->metrics.backtracks++);
+                    Lm.resize(k); //L[m] now only has the elements not on the same side of last[Lm]
+                    Lx.resize(k);
+                    Ly.resize(k);
+                    inWedge = false;
+                    bounds(); // we backtrack with the smaller rectangle of the new L[m]
+                }
+            };
+
+            // the greedy chain of a spiral sweeps half a turn, and its rectangle covers most of the polygon, while the notch that cuts it is
+            // usually next to the first vertex. So we go through the cells in squares around the cell of the first vertex, which is always under
+            // the rectangle, and the first backtrack leaves only a few of them. The squares double in size, so a row takes O(log cells) runs
+            int hy = grid.row(P[v[0]].y), hx = grid.col(P[v[0]].x);
+            for(int r = 0, inner = -1; !collapsed and Lm.size() > 2 and inner < max({hy - cy1, cy2 - hy, hx - cx1, cx2 - hx}); inner = r, r = 2*r + 1)
+            {
+                for(int cy = max(hy - r, cy1); cy <= min(hy + r, cy2); cy++){ // the cells of the square of r that are not in the one of inner
+                    if(abs(cy - hy) > inner) scan(cy, hx - r, hx + r);
+                    else if(hx - inner > cx1 or hx + inner < cx2){
+                        scan(cy, hx - r, hx - inner - 1);
+                        scan(cy, hx + inner + 1, hx + r);
                     }
+                    else cy = hy + inner; // the rectangle has no cells left or right of the inner square, we skip its rows
                 }
             }
         }
 
-        if(L[m].back() != v[1]){
-            if(L[m].back()->next() != L[m].front()) {
-                this->split(L[m].front(), L[m].back()); //if new polygon in L[m] is valid, split the parent face based on the new polygon
+        if(Lm.back() != v[1]){
+            if(this->next(Lm.back()) != Lm.front()) {
+                this->split(Lm.front(), Lm.back()); //if new polygon in L[m] is valid, split the parent face based on the new polygon
+                for(size_t j = 1; j + 1 < Lm.size(); j++){ // the vertices cut off with the new face leave LPVS and are no start any more
+                    grid.remove(Lm[j]);
+                    drop(Lm[j]);
+                    this->failed[Lm[j]] = 0;
+                    retry(Lm[j]);
+                }
+                if(!this->isNotch(Lm.front())) grid.remove(Lm.front()); // the ends of the diagonal may stop being notches
+                retry(Lm.front()); // the front now links to the back
+                if(!this->isNotch(Lm.back())){
+                    grid.remove(Lm.back());
+                    retry(Lm.back());
+                }
+            }
+            n = n-Lm.size() + 2;
+        }
+        else{ // nothing was cut off, v[0] fails again until the link out of one of v[0..i] changes or a notch that cut L[m] goes
+            drop(v[0]);
+            this->failed[v[0]] = stamp;
+            if(witness != NIL){ // see firstCut, only the links out of v[0] and v[1] and that notch matter, not the rest of the chain
+                watch(v[0]);
+                watch(v[1]);
+                watch(witness);
+            }
+            else{
+                for(size_t j = 0; j + 1 < v.size(); j++) watch(v[j]);
+                for(Id V: cuts) watch(V);
             }
-            n = n-L[m].size() + 2;
         }
-        m++;
+        prevLast = Lm.back();
     }
+    METRIC(this->metrics.algorithm1Time = steadySeconds() - st);
+    return true;
 }
 
-void DCEL::merging()
+template<class C, Winding W> void BasicDCEL<C, W>::merging(size_t from)
 {
+    METRIC(double st = steadySeconds());
     int m = this->diags.size();
-    int np = m+1;
-    this->LDP.resize(np,true); // LDP is an array indication if the ith face is part of the decomposition or not
+    this->LDP.resize(m+1,true); // LDP is an array indication if the ith face is part of the decomposition or not
 
-    Vertex *Vs, *Vt;
-    for(int j = 0; j < m; j++) // we loop through every diagonal in the decomposition
-    {
-        Vt = this->diags[j]->origin;
-        Vs = this->diags[j]->next->origin;
-
-        Vertex *j2 = Vt;
-        Vertex *i2 = Vs;
-        Vertex *i1 = this->diags[j]->next->next->origin;
-        Vertex* j1 = this->diags[j]->twin->next->next->origin; 
-        Vertex* i3 = this->diags[j]->twin->face->prev(Vs);
-        Vertex *j3= this->diags[j]->face->prev(Vt); // we get the vertices surrounding the diagonal on either side respectively
-        
-        bool x = !signedArea(i1, i2, i3), y = !signedArea(j1, j2, j3); // we check if the removal of the diagonal will create a notch
-
-        if( x && y ) // if no notch will be created, we merge
-        {
-            np++;
-            Face* cur = new Face(); // we create a new face
-            HalfEdge* e = this->diags[j]->next;
-            cur->outerComponent = e;
-            HalfEdge* hold;
-            do{
-                e->face = cur;
-                e = e->next;
-                if(e->next->origin==Vt){
-                    hold = e; // stores the edge just before vt
-                }
-            }while(e->origin != Vt); // we assign the new face to every edge in the old face till vt
-
-            hold->next = this->diags[j]->twin->next; // we make a new connection skipping the diagonal
+    for(int j = from; j < m; j++) // we loop through every diagonal in the decomposition
+        this->merge(this->diags[j]);
+    METRIC(this->metrics.kept = m - this->metrics.merged; this->metrics.mergingTime = steadySeconds() - st);
+}
 
-            e = this->diags[j]->twin->next;
-            do{
-                e->face = cur;
-                e = e->next;
-                if(e->next->origin==Vs){
-                    hold = e;
-                }
-            }while(e->origin != Vs); // we assign the remaining edges to the new face
-            hold->next = this->diags[j]->next;
+template<class C, Winding W> bool BasicDCEL<C, W>::merge(Id d){
+    vector<HalfEdge>& he = this->halfEdges;
+    const vector<Point>& P = this->vertices;
+    Id t = he[d].twin;
+    Id Vt = he[d].origin;
+    Id Vs = he[t].origin;
 
-            this->faces.push_back(cur);
-            this->mp[np-1] = cur;
-            this->mp1[cur] = np-1; // we add the new face and its index to the map
+    Id j2 = Vt;
+    Id i2 = Vs;
+    Id i1 = he[he[he[d].next].next].origin;
+    Id j1 = he[he[he[t].next].next].origin; 
+    Id i3 = he[he[t].prev].origin;
+    Id j3 = he[he[d].prev].origin; // we get the vertices surrounding the diagonal on either side respectively, the prev links make this O(1)
+    
+    bool x = !signedArea(P[i1], P[i2], P[i3]), y = !signedArea(P[j1], P[j2], P[j3]); // we check if the removal of the diagonal will create a notch
 
-            this->LDP.push_back(true);
-            this->LDP[mp1[this->diags[j]->face]] = false;
-            this->LDP[mp1[this->diags[j]->twin->face]] = false; // we update the LDP array
-        }
-    }
-}
+    if(!( x && y )) // if a notch would be created, we keep the diagonal
+        return false;
 
-int main(){
-    /**
-     * @brief This is the main function.
-     * We open and loop through the input folders and create respective output folders
-     * For each input we read, we start a timer, create the DCEL, and call the functions algorithmi(); and merging();
-     * Then we print the result into the output file
-     */
+    Id cur = this->faces.size(); // we create a new face
+    this->faces.emplace_back();
+    this->faces[cur].outerComponent = he[d].next;
 
-    //PRITHVI RAJAN 2020A7PS2080H
-    //PRAJWAL NAYAK 2020A7PS2059H
-    //MEDINI N B 2020A7PS1722H
+    he[he[d].prev].next = he[t].next; // we make new connections skipping the diagonal on both sides
+    he[he[t].next].prev = he[d].prev;
+    he[he[t].prev].next = he[d].next;
+    he[he[d].next].prev = he[t].prev;
 
-    mkdir("./decomposed", 0777);
+    Id fd = this->faceOf(d), ft = this->faceOf(t);
+    this->faces[fd].mergedInto = cur; // instead of walking both faces to relabel their edges, we record that they now belong to cur
+    this->faces[ft].mergedInto = cur;
 
-    //below for loop is for n folders that we used for testing
-    for(int n=8; n<=30; n++) {
+    this->LDP.push_back(true);
+    this->LDP[fd] = false;
+    this->LDP[ft] = false; // we update the LDP array
+    METRIC(this->metrics.merged++);
+    return true;
+}
 
-        string input_folder = "./polygons_input/" + to_string(n) + "/";
-        string output_folder = "./decomposed/" + to_string(n) + "/";
+template<class C, Winding W> size_t BasicDCEL<C, W>::update(const vector<Edit>& edits){
+    static_assert(is_same_v<BasicDCEL, DCEL>, "update tests the edits against the polygon in doubles, in counter-clockwise order");
+    vector<HalfEdge>& he = this->halfEdges;
+    DCEL piece; // the region we decompose again, reused by every edit
+    unordered_set<Id> region; // the faces we dissolve
+    vector<Id> border, cycle, sorted, more, ids, edges, local;
 
-        int result = mkdir(output_folder.c_str(), 0777); // create output folder if it doesn't exist
+    auto inside = [&](Id e){ // e is between two faces of the region, so it goes away with them
+        Id t = he[e].twin;
+        return he[t].face != NIL and region.count(this->faceOf(t));
+    };
+    auto around = [&](Id v){ // we add the faces at v, turning around it over the half-edges that leave it
+        Id e = this->boundary[v];
+        do{
+            if(he[e].face != NIL) region.insert(this->faceOf(e));
+            e = he[he[e].prev].twin;
+        } while(e != this->boundary[v]);
+    };
 
-        if (result == -1) {
-            perror("Error creating decomposed directory");
-            return 1;
-        }
+    for(size_t k = 0; k < edits.size(); k++){
+        const Edit& edit = edits[k];
+        Id v = edit.vertex;
+        if(v >= this->vertices.size() or this->boundary[v] == NIL) return k;
+        Id out = this->boundary[v], back = he[out].twin; // v -> w, and w -> v on the outside
+        Id in = he[he[back].next].twin; // u -> v, the outside goes on from v to u
+        Id u = he[in].origin, w = he[back].origin;
+        if(edit.kind == EditKind::Delete and he[he[this->boundary[w]].twin].origin == u) return k; // a triangle stays a triangle
 
-        //below for loop is for reading 10 input text files that we used for testing
-        for(int i=1; i<=10; i++) {
+        Vertex to(edit.x, edit.y);
+        auto at = [&](Id x) -> const Vertex& { return x == NIL ? to : this->vertices[x]; }; // NIL stands for the moved or new vertex
+        vector<pair<Id,Id>> fresh; // the edges the edit makes
+        if(edit.kind == EditKind::Move) fresh = {{u, NIL}, {NIL, w}};
+        else if(edit.kind == EditKind::Insert) fresh = {{v, NIL}, {NIL, w}};
+        else fresh = {{u, w}};
 
-            string input_file = input_folder + to_string(n) + "_" + to_string(i) + ".txt";
-            string output_file = output_folder + to_string(n) + "_" + to_string(i) + ".txt";
+        // we start from the faces at the edited vertex and at the ends of the new edges. A new edge that crosses a diagonal on the
+        // border pulls in the face behind it, one that crosses the polygon boundary is refused. The border must end up as one cycle
+        // through every vertex at most once, so that it is a simple polygon, a vertex it passes twice gets all of its faces added
+        region.clear();
+        around(v);
+        if(edit.kind != EditKind::Insert) around(u);
+        around(w);
+        while(true){
+            border.clear();
+            for(Id f: region){
+                Id e = this->faces[f].outerComponent;
+                do{
+                    if(!inside(e)) border.push_back(e);
+                    e = he[e].next;
+                } while(e != this->faces[f].outerComponent);
+            }
 
-            //freopen("input.txt", "r", stdin);
-            //freopen("output.txt", "w", stdout);
-            freopen(input_file.c_str(), "r", stdin);
-            freopen(output_file.c_str(), "w", stdout);
+            more.clear();
+            for(Id e: border){
+                Id a = he[e].origin, b = he[he[e].twin].origin;
+                if(edit.kind == EditKind::Insert ? e == out : a == v or b == v) continue; // the edit replaces this edge
+                for(auto [p, q]: fresh){
+                    if(a == p or a == q or b == p or b == q or !segmentsMeet(at(p), at(q), this->vertices[a], this->vertices[b])) continue;
+                    if(he[he[e].twin].face == NIL) return k;
+                    more.push_back(this->faceOf(he[e].twin));
+                }
+            }
+            if(!more.empty()){
+                region.insert(more.begin(), more.end());
+                continue;
+            }
 
+            cycle.clear();
+            Id e = border[0];
+            do{
+                cycle.push_back(e);
+                e = he[e].next;
+                while(inside(e)) e = he[he[e].twin].next; // we turn around the end of the edge until we are back on the border
+            } while(e != border[0] and cycle.size() <= border.size());
 
-            struct timespec st1={0,0}, st2={0,0};
-            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &st1);
-            vector<Vertex*> inp;
-            int siz;cin>>siz;
+            Id twice = NIL;
+            sorted.clear();
+            for(Id c: cycle) sorted.push_back(he[c].origin);
+            sort(sorted.begin(), sorted.end());
+            for(size_t i = 1; i < sorted.size() and twice == NIL; i++) if(sorted[i] == sorted[i-1]) twice = sorted[i];
+            if(twice == NIL and cycle.size() < border.size()){ // the region has a hole, we grow it from a vertex of the hole
+                sorted = cycle;
+                sort(sorted.begin(), sorted.end());
+                for(Id c: border) if(!binary_search(sorted.begin(), sorted.end(), c)){
+                    twice = he[c].origin;
+                    break;
+                }
+            }
+            if(twice == NIL) break;
+            around(twice);
+        }
 
-            for (int i = 0; i < siz; ++i)
+        // the border with the edit applied is the polygon we decompose again, edges[i] is the half-edge from ids[i] to ids[i+1]
+        Id added = this->vertices.size(), addedEdge = he.size();
+        ids.clear();
+        edges.clear();
+        for(Id c: cycle){
+            Id a = he[c].origin;
+            if(edit.kind == EditKind::Delete and a == v) continue;
+            ids.push_back(a);
+            edges.push_back(c);
+            if(edit.kind == EditKind::Insert and a == v){
+                ids.push_back(added);
+                edges.push_back(addedEdge);
+            }
+        }
+        piece.reset();
+        for(Id a: ids){
+            const Vertex& p = a == added or (edit.kind == EditKind::Move and a == v) ? to : this->vertices[a];
+            piece.addVertex(p.x, p.y);
+        }
+        piece.build();
+        piece.algorithm1();
+        piece.merging();
+
+        // the edit itself, on the vertices and on the polygon boundary
+        if(edit.kind == EditKind::Move){
+            this->vertices[v].x = this->xs[v] = to.x;
+            this->vertices[v].y = this->ys[v] = to.y;
+        }
+        else if(edit.kind == EditKind::Insert){ // v -> w becomes v -> x -> w, its twin becomes x -> v after the new w -> x
+            this->addVertex(to.x, to.y);
+            this->xs.push_back(to.x);
+            this->ys.push_back(to.y);
+            this->boundary.push_back(addedEdge);
+            this->vertices[added].incidentEdge = addedEdge;
+            he.emplace_back();
+            he.emplace_back();
+            Id twin = addedEdge + 1;
+            he[addedEdge].origin = added;
+            he[addedEdge].twin = twin;
+            he[twin].origin = w;
+            he[twin].twin = addedEdge;
+            he[twin].prev = he[back].prev;
+            he[he[back].prev].next = twin;
+            he[twin].next = back;
+            he[back].prev = twin;
+            he[back].origin = added;
+        }
+        else{ // u -> v -> w becomes u -> w, the half-edge u -> v is kept for it and the twin v -> u turns into w -> u
+            Id twin = he[in].twin;
+            he[twin].origin = w;
+            he[twin].prev = he[back].prev;
+            he[he[back].prev].next = twin;
+            this->boundary[v] = NIL;
+            this->vertices[v].incidentEdge = NIL;
+        }
+
+        // the pieces of the region replace its old faces, the half-edges of piece are mapped to ours and their links copied
+        const vector<HalfEdge>& lhe = piece.halfEdges;
+        local.assign(lhe.size(), NIL);
+        for(size_t i = 0; i < edges.size(); i++) local[i] = edges[i];
+        for(Id d: piece.diags){
+            if(lhe[lhe[d].prev].next != d) continue; // merged away
+            Id g = he.size(), t = lhe[d].twin;
+            he.emplace_back();
+            he.emplace_back();
+            he[g].origin = ids[lhe[d].origin];
+            he[g+1].origin = ids[lhe[t].origin];
+            he[g].twin = g+1;
+            he[g+1].twin = g;
+            local[d] = g;
+            local[t] = g+1;
+            this->diags.push_back(g);
+        }
+        for(size_t h = 0; h < lhe.size(); h++){
+            if(local[h] == NIL) continue;
+            he[local[h]].next = local[lhe[h].next];
+            he[local[h]].prev = local[lhe[h].prev];
+        }
+        for(Id f: region) this->LDP[f] = false;
+        for(Id f = 0; f < piece.faces.size(); f++){
+            if(!piece.LDP[f]) continue;
+            Id cur = this->faces.size();
+            this->faces.emplace_back();
+            this->faces[cur].outerComponent = local[piece.faces[f].outerComponent];
+            this->LDP.push_back(true);
+            Id e = this->faces[cur].outerComponent;
+            do{
+                he[e].face = cur;
+                e = he[e].next;
+            } while(e != this->faces[cur].outerComponent);
+        }
+
+        for(Id e: edges) if(he[he[e].twin].face != NIL) this->merge(e); // only the border can merge with the faces around the region
+    }
+    return edits.size();
+}
+
+template<class C, Winding W> void BasicDCEL<C, W>::addDiagonals(const vector<pair<Id,Id>>& diagonals){
+    int n = this->vertices.size();
+    vector<HalfEdge>& he = this->halfEdges;
+    const vector<Point>& P = this->vertices;
+    for(auto [u, v]: diagonals){
+        Id one = he.size(), two = one + 1;
+        he.emplace_back();
+        he.emplace_back();
+        he[one].origin = u;
+        he[two].origin = v;
+        he[one].twin = two;
+        he[two].twin = one;
+        this->diags.push_back(one);
+    }
+
+    // at a vertex with diagonals we sort its outgoing half-edges counter-clockwise by direction. Walking a face with the face on our
+    // left, the edge after u->v is the one right before v->u in that order around v. This holds for the outer twins as well, and the
+    // vertices without diagonals keep the links build() gave them. For a clockwise polygon everything is mirrored, the order too
+    vector<Id> around;
+    vector<Id> touched;
+    for(Id d: this->diags){
+        touched.push_back(he[d].origin);
+        touched.push_back(he[he[d].twin].origin);
+    }
+    sort(touched.begin(), touched.end());
+    touched.erase(unique(touched.begin(), touched.end()), touched.end());
+    vector<vector<Id>> out(touched.size());
+    for(Id d: this->diags){
+        for(Id e: {d, he[d].twin}) out[lower_bound(touched.begin(), touched.end(), he[e].origin) - touched.begin()].push_back(e);
+    }
+    for(size_t i = 0; i < touched.size(); i++){
+        Id v = touched[i];
+        around = out[i];
+        around.push_back(v); // the boundary edge v -> v+1 and the twin v -> v-1
+        around.push_back(n + (v + n - 1) % n);
+        auto half = [&](Id e){ // 0 for the directions in the upper half-plane, 1 for the lower one
+            const Point& to = P[he[he[e].twin].origin];
+            return to.y < P[v].y or (to.y == P[v].y and (W == Winding::CounterClockwise ? to.x < P[v].x : to.x > P[v].x));
+        };
+        sort(around.begin(), around.end(), [&](Id a, Id b){
+            bool ha = half(a), hb = half(b);
+            if(ha != hb) return ha < hb;
+            return this->turn(P[v], P[he[he[a].twin].origin], P[he[he[b].twin].origin]) > 0;
+        });
+        for(size_t k = 0; k < around.size(); k++){
+            Id in = he[around[k]].twin, after = around[k ? k - 1 : around.size() - 1];
+            he[in].next = after;
+            he[after].prev = in;
+        }
+    }
+
+    this->faces.clear(); // every cycle of the inner half-edges is a face, the twins of the boundary (n to 2n-1) stay outside
+    for(Id e = 0; e < he.size(); e++) he[e].face = NIL;
+    for(Id e = 0; e < he.size(); e++){
+        if((e >= (Id)n and e < 2*(Id)n) or he[e].face != NIL) continue;
+        Id f = this->faces.size();
+        this->faces.emplace_back();
+        this->faces[f].outerComponent = e;
+        Id x = e;
+        do{
+            he[x].face = f;
+            x = he[x].next;
+        } while(x != e);
+    }
+}
+
+template<class C, Winding W> void BasicDCEL<C, W>::triangulate(){
+    static_assert(is_same_v<BasicDCEL, DCEL>, "the sweep of triangulate is written for doubles in counter-clockwise order");
+    int n = this->vertices.size();
+    METRIC(double st = steadySeconds(); this->metrics.polygons = 1; this->metrics.vertices = n);
+    const vector<Vertex>& P = this->vertices;
+    // a is above b if it comes first in the sweep, points of the same height go from left to right as if the sweep line was slightly
+    // tilted, so no two vertices are at the same height and a horizontal edge has an upper and a lower end like any other
+    auto above = [&](Id a, Id b){ return P[a].y > P[b].y or (P[a].y == P[b].y and P[a].x < P[b].x); };
+    auto turn = [&](Id a, Id b, Id c){ return orient(P[a].x, P[a].y, P[b].x, P[b].y, P[c].x, P[c].y); };
+
+    enum { START, END, SPLIT, MERGE, REGULAR };
+    vector<char> type(n);
+    for(int v = 0; v < n; v++){
+        Id u = (v + n - 1) % n, w = (v + 1) % n;
+        bool convex = turn(u, v, w) > 0;
+        if(above(v, u) and above(v, w)) type[v] = convex ? START : SPLIT;
+        else if(above(u, v) and above(w, v)) type[v] = convex ? END : MERGE;
+        else type[v] = REGULAR;
+    }
+    vector<Id> order(n);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), above);
+
+    // the sweep status holds the edges with the inside of the polygon to their right that cross the sweep line, from left to right.
+    // Edge e goes from vertex e to vertex e+1, and id n stands for the current event, so that lower_bound(n) is the first edge right of it.
+    // A horizontal edge is never crossed by the sweep line between its two ends, so we only ever need its x at one of them
+    Id event = 0;
+    auto xAt = [&](Id e){
+        const Vertex& q = P[event];
+        if(e == (Id)n) return q.x;
+        const Vertex& a = P[e];
+        const Vertex& b = P[(e + 1) % n];
+        if(a.y == b.y) return min(max(q.x, min(a.x, b.x)), max(a.x, b.x));
+        return a.x + (q.y - a.y) * (b.x - a.x) / (b.y - a.y);
+    };
+    auto left = [&](Id e, Id f){
+        double xe = xAt(e), xf = xAt(f);
+        return xe < xf or (xe == xf and e < f);
+    };
+    set<Id, decltype(left)> status(left);
+    vector<typename set<Id, decltype(left)>::iterator> where(n);
+    vector<Id> helper(n);
+    vector<pair<Id,Id>> diagonals;
+    auto fix = [&](Id e, Id v){ // the diagonal to the merge vertex that was waiting for a vertex below it
+        if(type[helper[e]] == MERGE) diagonals.push_back({v, helper[e]});
+    };
+    auto leftOf = [&](auto then){ // the edge directly left of event, there is one for every split, merge and regular vertex of a simple polygon
+        auto it = status.lower_bound(n);
+        if(it != status.begin()) then(*prev(it));
+    };
+    for(Id v: order){
+        event = v;
+        Id in = (v + n - 1) % n; // the edge that ends at v
+        switch(type[v]){
+            case START:
+                where[v] = status.insert(v).first;
+                helper[v] = v;
+                break;
+            case END:
+                fix(in, v);
+                status.erase(where[in]);
+                break;
+            case SPLIT:
+                leftOf([&](Id e){ diagonals.push_back({v, helper[e]}); helper[e] = v; });
+                where[v] = status.insert(v).first;
+                helper[v] = v;
+                break;
+            case MERGE:
+                fix(in, v);
+                status.erase(where[in]);
+                leftOf([&](Id e){ fix(e, v); helper[e] = v; });
+                break;
+            default:
+                if(above(in, v)){ // the boundary goes down through v, so the inside is to its right
+                    fix(in, v);
+                    status.erase(where[in]);
+                    where[v] = status.insert(v).first;
+                    helper[v] = v;
+                }
+                else leftOf([&](Id e){ fix(e, v); helper[e] = v; });
+        }
+    }
+    this->addDiagonals(diagonals);
+
+    // every face is y-monotone now. We go down both of its chains at once and cut off every triangle we can with a stack of the
+    // vertices that still need one, this is the triangulation of monotone polygons from de Berg et al.
+    diagonals.clear();
+    vector<Id> face, sorted, stack;
+    vector<char> chain(n); // 1 for the left chain of the face, 2 for the right one
+    for(Id f = 0; f < this->faces.size(); f++){
+        face.clear();
+        Id e = this->faces[f].outerComponent;
+        do{
+            face.push_back(this->halfEdges[e].origin);
+            e = this->halfEdges[e].next;
+        } while(e != this->faces[f].outerComponent);
+        int k = face.size();
+        if(k == 3) continue;
+        int top = 0, bottom = 0;
+        for(int i = 1; i < k; i++){
+            if(above(face[i], face[top])) top = i;
+            if(above(face[bottom], face[i])) bottom = i;
+        }
+        sorted.clear(); // going counter-clockwise from the top is going down the left chain, going clockwise is going down the right one
+        sorted.push_back(face[top]);
+        int a = (top + 1) % k, b = (top + k - 1) % k;
+        while(a != bottom or b != bottom){
+            if(b == bottom or (a != bottom and above(face[a], face[b]))){
+                chain[face[a]] = 1;
+                sorted.push_back(face[a]);
+                a = (a + 1) % k;
+            }
+            else{
+                chain[face[b]] = 2;
+                sorted.push_back(face[b]);
+                b = (b + k - 1) % k;
+            }
+        }
+        sorted.push_back(face[bottom]);
+
+        stack.assign(sorted.begin(), sorted.begin() + 2);
+        for(int j = 2; j + 1 < k; j++){
+            Id u = sorted[j];
+            if(chain[u] != chain[stack.back()]){ // u sees every vertex on the stack, the lowest one is its neighbour already
+                for(size_t i = 1; i < stack.size(); i++) diagonals.push_back({u, stack[i]});
+                stack.assign({sorted[j-1], u});
+            }
+            else{
+                Id last = stack.back();
+                stack.pop_back();
+                // the diagonal to the next vertex of the stack is inside as long as the chain bulges out at the last one
+                while(!stack.empty() and (chain[u] == 1 ? turn(stack.back(), u, last) < 0 : turn(stack.back(), u, last) > 0)){
+                    last = stack.back();
+                    stack.pop_back();
+                    diagonals.push_back({u, last});
+                }
+                stack.push_back(last);
+                stack.push_back(u);
+            }
+        }
+        for(size_t i = 1; i + 1 < stack.size(); i++) diagonals.push_back({sorted[k-1], stack[i]}); // the bottom sees the rest of the stack
+    }
+    this->addDiagonals(diagonals);
+    METRIC(this->metrics.splits = this->diags.size(); this->metrics.algorithm1Time = steadySeconds() - st);
+}
+
+class BinaryFile;
+
+/// @brief One polygon of a batch, and where its decomposition goes
+/// @param input Path of the polygon file, unused when the polygon comes from a binary container
+/// @param output Path of the file the decomposition is written to, unused when it goes to a binary container
+/// @param name Name of the polygon, its path relative to the batch, which we also store in binary containers
+/// @param size Size of the input in bytes, we use it to hand out the big jobs first
+/// @param source Binary container the polygon is read from, nullptr to read it from input
+/// @param record Index of the polygon in source
+/// @param result Where the binary record of the decomposition goes, nullptr to write it as text to output
+/// @param request Polygon record of a request to daa serve, which is read instead of source or input when it is not nullptr. It may
+/// be result as well, the polygon is read before the decomposition is written
+class Job {
+public:
+    string input;
+    string output;
+    string name;
+    uintmax_t size;
+    const BinaryFile* source = nullptr;
+    uint32_t record = 0;
+    vector<char>* result = nullptr;
+    const vector<char>* request = nullptr;
+};
+
+/// @brief Deque of jobs owned by one worker of a batch.
+/// The owner takes jobs from the back, and workers that run out of jobs steal from the front, so a few huge polygons do not leave the other threads idle.
+/// @param lock Guards jobs
+/// @param jobs Indices of the jobs in the batch
+class JobQueue {
+public:
+    mutex lock;
+    deque<size_t> jobs;
+
+    /// @brief Takes the job at the back of the queue, used by the owner
+    /// @param job The index of the job that was taken
+    /// @return false if the queue was empty
+    bool pop(size_t& job);
+
+    /// @brief Takes the job at the front of the queue, used by the other workers
+    /// @param job The index of the job that was taken
+    /// @return false if the queue was empty
+    bool steal(size_t& job);
+};
+
+/// @brief Reads a polygon file, the number of vertices followed by the x and y of every vertex, into a DCEL.
+/// The file is memory mapped and the numbers are parsed straight from the mapping, without copying it into a stream first.
+/// @param path Path of the polygon file
+/// @param polygon The DCEL to fill, it is reset and built
+/// @return false if the file could not be read or does not hold a polygon, or if its count is more vertices than the file has room for
+bool readPolygon(const string& path, DCEL& polygon);
+
+/// @brief Formats the decomposition into one growing buffer, that is written out with a single write() per polygon.
+/// Numbers are formatted like the default of an ostream, so the files are the same as the ones we wrote with cout.
+/// @param buffer The formatted text, only the first used bytes are valid
+/// @param used Number of bytes formatted so far
+class OutputWriter {
+public:
+    vector<char> buffer;
+    size_t used = 0;
+
+    /// @brief Appends a number, with 6 significant digits like an ostream
+    /// @param x The number
+    void put(double x);
+
+    /// @brief Appends a string
+    /// @param text The string
+    /// @param len Its length
+    void put(const char* text, size_t len);
+
+    /// @brief Appends every face of the decomposition, one "x, y" line per vertex and a blank line after every face
+    /// @param polygon The decomposed DCEL, or BasicDCEL of any layout
+    template<class D> void putFaces(const D& polygon);
+
+    /// @brief Writes the buffer to a file and empties it
+    /// @param path Path of the file
+    /// @return false if the file could not be written
+    bool save(const string& path);
+};
+
+/// @brief Header at the start of a binary container. The binary files hold one or many polygons, or one or many decompositions,
+/// as records that can be used straight from a memory mapping. Everything is little-endian and every record starts at a multiple of 8 bytes.
+///   header       magic "DCEL", version, kind, number of records, reserved
+///   offsets      uint64 byte offset of every record from the start of the file, and one more for the end of the last record
+///   polygon      uint32 n, uint32 name length, the name padded to 8 bytes, n times double x, double y
+///   decomposition uint32 n, uint32 name length, uint32 pieces, uint32 diagonals, double seconds, the name padded to 8 bytes,
+///                uint32 pairs of vertex indices of the diagonals that are left after merging, uint32 start of every piece and one more
+///                for the end in the list that follows, and the uint32 indices of the vertices of every piece in the winding of the polygon
+///   cache entry  a polygon record named after the settings of the decomposition, see CacheKey, with its vertices moved so that the
+///                first one is at the origin, then double seconds, uint32 diagonals, uint32 0 and the uint32 pairs of vertex indices
+/// @param magic Always "DCEL"
+/// @param version BINARY_VERSION of the program that wrote the file
+/// @param kind BINARY_POLYGONS, BINARY_DECOMPOSITIONS or BINARY_CACHE
+/// @param records Number of records in the file
+/// @param reserved Always 0
+class BinaryHeader {
+public:
+    char magic[4];
+    uint16_t version;
+    uint16_t kind;
+    uint32_t records;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(BinaryHeader) == 16, "the binary header is written as it is laid out in memory");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "the binary format is little-endian and we read it without swapping bytes");
+
+/// @brief Version of the binary format that we read and write
+const uint16_t BINARY_VERSION = 1;
+
+/// @brief Kind of a binary container that holds polygons
+const uint16_t BINARY_POLYGONS = 1;
+
+/// @brief Kind of a binary container that holds decompositions
+const uint16_t BINARY_DECOMPOSITIONS = 2;
+
+/// @brief Kind of a binary container that holds the disk tier of a ResultCache
+const uint16_t BINARY_CACHE = 3;
+
+/// @brief A binary container mapped into memory, see BinaryHeader for its layout
+/// @param data Start of the mapping
+/// @param length Length of the mapping in bytes
+/// @param header The header of the file
+/// @param offsets Offsets of the records, header.records + 1 of them
+class BinaryFile {
+public:
+    const char* data = nullptr;
+    size_t length = 0;
+    BinaryHeader header;
+    const uint64_t* offsets = nullptr;
+
+    BinaryFile() {}
+    BinaryFile(const BinaryFile&) = delete;
+    ~BinaryFile();
+
+    /// @brief Maps a binary container and checks its header and offsets
+    /// @param path Path of the file
+    /// @return false if the file could not be mapped or is not a binary container of this version
+    bool open(const string& path);
+
+    /// @brief Reads a uint32 field of a record
+    /// @param record Index of the record
+    /// @param field Index of the uint32 field from the start of the record
+    /// @return The value of the field
+    uint32_t field(uint32_t record, int field) const;
+
+    /// @brief Finds the name of a record
+    /// @param record Index of the record
+    /// @return The name
+    string name(uint32_t record) const;
+
+    /// @brief Finds where the data of a record starts, after its fields and name
+    /// @param record Index of the record
+    /// @return Pointer to the data
+    const char* body(uint32_t record) const;
+};
+
+/// @brief Checks if a file starts like a binary container
+/// @param path Path of the file
+/// @return true if it starts with the magic of BinaryHeader
+bool isBinary(const string& path);
+
+/// @brief Fills a DCEL with a polygon record of a binary container, the coordinates are copied straight out of the mapping
+/// @param file The container, of kind BINARY_POLYGONS
+/// @param record Index of the record
+/// @param polygon The DCEL to fill, it is reset
+/// @return false if the record is not a valid polygon
+bool loadPolygon(const BinaryFile& file, uint32_t record, DCEL& polygon);
+
+/// @brief Fills a DCEL with a polygon record that is not in a container, like the ones of the requests to daa serve
+/// @param record Start of the record, see BinaryHeader
+/// @param length Length of the record in bytes
+/// @param polygon The DCEL to fill, it is reset
+/// @return false if the record is not a valid polygon
+bool decodePolygon(const char* record, size_t length, DCEL& polygon);
+
+/// @brief Finds the name of a polygon record that is not in a container
+/// @param record Start of the record
+/// @param length Length of the record in bytes
+/// @return The name, cut off at the end of the record
+string recordName(const char* record, size_t length);
+
+/// @brief Appends the polygon record of the vertices of a DCEL to a buffer
+/// @param polygon The DCEL, only its vertices are used
+/// @param name Name of the record
+/// @param out The buffer
+void encodePolygon(const DCEL& polygon, const string& name, vector<char>& out);
+
+/// @brief Appends the decomposition record of a decomposed DCEL to a buffer
+/// @param polygon The DCEL after merging, or BasicDCEL of any layout
+/// @param name Name of the record
+/// @param seconds Time the decomposition took
+/// @param out The buffer
+template<class D> void encodeDecomposition(const D& polygon, const string& name, double seconds, vector<char>& out);
+
+/// @brief Formats a decomposition record as text, like OutputWriter::putFaces followed by the time
+/// @param file The container of the decomposition, of kind BINARY_DECOMPOSITIONS
+/// @param record Index of the decomposition in file
+/// @param polygons The container of the polygon, of kind BINARY_POLYGONS
+/// @param polygonRecord Index of the polygon in polygons
+/// @param writer Where the text goes
+/// @return false if the records do not belong together
+bool decodeDecomposition(const BinaryFile& file, uint32_t record, const BinaryFile& polygons, uint32_t polygonRecord, OutputWriter& writer);
+
+/// @brief Writes a binary container
+/// @param path Path of the file
+/// @param kind BINARY_POLYGONS, BINARY_DECOMPOSITIONS or BINARY_CACHE
+/// @param records The records, each one made by encodePolygon, encodeDecomposition or ResultCache
+/// @return false if the file could not be written
+bool writeBinary(const string& path, uint16_t kind, const vector<vector<char>>& records);
+
+/// @brief A polygon the way ResultCache looks it up. Two polygons get the same key if one is the other moved, or started from
+/// another vertex. We start from the lowest vertex, the leftmost of those, and subtract its coordinates from all of them. Moves are
+/// only matched when the subtraction gives the very same doubles, as it does for integer or grid coordinates and exact duplicates
+/// @param tag The engine and settings of the decomposition, decompositions made with other settings are never used
+/// @param start Index of the vertex the key starts from in the polygon
+/// @param coords X and y of every vertex from start on, minus those of start
+/// @param hash Hash of tag and coords
+class CacheKey {
+public:
+    string tag;
+    Id start = 0;
+    vector<double> coords;
+    uint64_t hash = 0;
+
+    /// @brief Makes the key of a polygon
+    /// @param polygon The DCEL, only its vertices are used
+    /// @param tag The engine and settings of the decomposition
+    void make(const DCEL& polygon, const string& tag);
+
+    /// @brief Finds the size of the entry of this key in the memory tier, to count it against the budget
+    /// @param diagonals Number of diagonals of the decomposition
+    /// @return The size in bytes
+    size_t bytes(size_t diagonals) const;
+};
+
+/// @brief A decomposition in the memory tier of a ResultCache
+/// @param key The polygon it belongs to
+/// @param diagonals Pairs of vertex indices of the diagonals that are left after merging, counted from key.start
+/// @param seconds Time the decomposition took, what a hit saves
+class CacheEntry {
+public:
+    CacheKey key;
+    vector<Id> diagonals;
+    double seconds;
+};
+
+/// @brief Where ResultCache::find found a decomposition
+enum class CacheTier { None, Memory, Disk };
+
+/// @brief Decompositions of the polygons seen so far, so that a polygon that comes again, moved or from another first vertex, is
+/// not decomposed again. We keep the diagonals as vertex indices and add them to the new polygon with DCEL::addDiagonals, which
+/// gives the same pieces. The memory tier keeps the entries that were used last, up to a number of bytes. The disk tier is a binary
+/// container of kind BINARY_CACHE that we map when the cache is opened and write again with the new entries when it is saved, so
+/// that the next run finds them. Keys are compared in full, two polygons with the same hash never share a decomposition.
+/// All the functions can be called from many threads
+/// @param budget Bytes the memory tier may hold
+/// @param path Path of the disk tier, empty for none
+/// @param entries The memory tier, the entry used last first
+/// @param index The entries of the memory tier by hash
+/// @param bytes Bytes held by the memory tier
+/// @param disk The mapping of the disk tier as it was when the cache was opened
+/// @param diskIndex The records of disk by hash
+/// @param added Records of the entries made since the cache was opened, for the disk tier
+class ResultCache {
+public:
+    size_t budget = 0;
+    string path;
+    list<CacheEntry> entries;
+    unordered_multimap<uint64_t, list<CacheEntry>::iterator> index;
+    size_t bytes = 0;
+    BinaryFile disk;
+    unordered_multimap<uint64_t, uint32_t> diskIndex;
+    vector<vector<char>> added;
+    mutex lock;
+
+    /// @brief Sets the budget of the memory tier and maps the disk tier, if there is one and it exists already
+    /// @param budget Bytes the memory tier may hold
+    /// @param path Path of the disk tier, empty for none
+    /// @return false if path exists but is not a cache container
+    bool open(size_t budget, const string& path);
+
+    /// @brief Looks up a polygon, and on a hit decomposes it with the diagonals that were found for it
+    /// @param key The key of the polygon
+    /// @param polygon The DCEL, or BasicDCEL of any layout, with the vertices of the polygon added and not built yet. On a hit it holds
+    /// the decomposition afterwards
+    /// @param seconds On a hit, the time the decomposition took when it was made
+    /// @return Where the decomposition was found, CacheTier::None if it was not
+    template<class D> CacheTier find(const CacheKey& key, D& polygon, double& seconds);
+
+    /// @brief Adds the decomposition of a polygon that was not found, to both tiers
+    /// @param key The key of the polygon
+    /// @param polygon The DCEL, or BasicDCEL of any layout, after merging
+    /// @param seconds Time the decomposition took
+    template<class D> void insert(const CacheKey& key, const D& polygon, double seconds);
+
+    /// @brief Writes the disk tier again with the entries added since it was opened, if there are any
+    /// @return false if it could not be written
+    bool save();
+
+    /// @brief Puts an entry at the front of the memory tier and drops the ones used longest ago until it fits in the budget.
+    /// The lock must be held
+    /// @param entry The entry
+    void remember(CacheEntry&& entry);
+};
+
+/// @brief Adds up what a worker did, for the throughput report of a batch
+/// @param metrics The Metrics of every polygon added up
+/// @param metricsLog One JSON object with the Metrics of each polygon per line, only filled in when the worker logs them
+/// @param polygons Number of polygons decomposed
+/// @param vertices Number of vertices in those polygons
+/// @param readTime Seconds spent reading and parsing the input files
+/// @param decomposeTime Seconds spent in build, algorithm1 and merging
+/// @param writeTime Seconds spent formatting and writing the output files
+/// @param cacheHits Polygons found in the memory tier of the ResultCache
+/// @param diskHits Polygons found in its disk tier
+/// @param savedTime Seconds the decompositions that were found took when they were made, less the time of adding their diagonals
+class BatchStats {
+public:
+    uint64_t polygons = 0;
+    uint64_t vertices = 0;
+    double readTime = 0;
+    double decomposeTime = 0;
+    double writeTime = 0;
+    uint64_t cacheHits = 0;
+    uint64_t diskHits = 0;
+    double savedTime = 0;
+    Metrics metrics;
+    string metricsLog;
+
+    /// @brief Adds the numbers of another worker to these
+    /// @param other The numbers to add
+    void add(const BatchStats& other);
+};
+
+/// @brief The ways to decompose a polygon, all of them end with merging
+///   mp1   algorithm1, the MP1 heuristic of the paper. It usually gives the fewest pieces, but takes quadratic time on some polygons
+///   hm    triangulate, which makes merging the Hertel-Mehlhorn decomposition, at most four times the fewest pieces possible, in O(n log n)
+///   auto  mp1 while it takes less work than AUTO_BUDGET n log2 n, hm when it would take more
+enum class Engine { MP1, HertelMehlhorn, Auto };
+
+/// @brief Names of the engines, in the order of Engine, as they are given on the command line and written to the results
+const char* const ENGINE_NAMES[] = {"mp1", "hm", "auto"};
+
+/// @brief Work of algorithm1, as counted for its budget, per n log2 n after which Engine::Auto gives up on it for triangulate.
+/// algorithm1 stays below 20 on the random polygons of daa bench up to 10^6 vertices, and triangulate takes about as long as 10 to 20
+/// of it, so auto is never much more than three times slower than hm
+const double AUTO_BUDGET = 32;
+
+/// @brief Runs the part of an engine that comes before merging
+/// @param polygon The DCEL, just built
+/// @param engine The engine
+/// @return The engine that ran, mp1 or hm
+Engine partition(DCEL& polygon, Engine engine);
+
+/// @brief Builds and decomposes a polygon with one of the engines
+/// @param polygon The DCEL, with the vertices of the polygon added and not built yet. It holds the decomposition afterwards
+/// @param engine The engine
+/// @return The engine that made the decomposition, mp1 or hm
+Engine decompose(DCEL& polygon, Engine engine);
+
+/// @brief The coordinate policies of BasicDCEL, see DoubleCoords, FloatCoords, Int32Coords and Int64Coords
+enum class Coords { Double, Float, Int32, Int64 };
+
+/// @brief Names of the coordinate policies, in the order of Coords, as they are given to daa bench --coords
+const char* const COORDS_NAMES[] = {"double", "float", "int32", "int64"};
+
+/// @brief What inspect finds out about a polygon
+/// @param winding The order its vertices go around in
+/// @param coords The policy it is decomposed with: Int32 when all of its coordinates are integers below INT32_LIMIT, Double
+/// otherwise. Float and Int64 are slower than the AVX2 kernels of doubles, so they are only run by daa bench --coords
+/// @param floats Whether all of its coordinates are floats exactly, so that FloatCoords holds them
+/// @param integers Whether all of its coordinates are integers below INT64_LIMIT, so that Int64Coords holds them
+class PolygonLayout {
+public:
+    Winding winding;
+    Coords coords;
+    bool floats;
+    bool integers;
+
+    /// @brief Whether a coordinate policy holds all the coordinates of the polygon exactly
+    /// @param policy The policy
+    /// @return true if it does
+    bool fits(Coords policy) const;
+};
+
+/// @brief Finds the layout of a polygon in one pass over its vertices. The lowest vertex, the leftmost one of them if there are
+/// several, is a corner of the convex hull, so the turn its neighbours make at it is the winding of the polygon
+/// @param P The vertices of the polygon
+/// @return The layout
+PolygonLayout inspect(const vector<Vertex>& P);
+
+/// @brief The BasicDCELs of the layouts other than DCEL, one of each, so that whoever decomposes polygons of many layouts keeps all
+/// of their arenas warm
+class Arenas {
+public:
+    BasicDCEL<DoubleCoords, Winding::Clockwise> doubleClockwise;
+    BasicDCEL<FloatCoords> float32;
+    BasicDCEL<FloatCoords, Winding::Clockwise> float32Clockwise;
+    BasicDCEL<Int32Coords> int32;
+    BasicDCEL<Int32Coords, Winding::Clockwise> int32Clockwise;
+    BasicDCEL<Int64Coords> int64;
+    BasicDCEL<Int64Coords, Winding::Clockwise> int64Clockwise;
+};
+
+/// @brief Copies the vertices of a polygon into the BasicDCEL of a coordinate policy and a winding, and calls f with it. For doubles
+/// in counter-clockwise order that is the DCEL of the polygon itself, and nothing is copied
+/// @param polygon The DCEL, with the vertices of the polygon added and not built yet
+/// @param policy The coordinate policy, it must fit the polygon
+/// @param winding The winding of the polygon
+/// @param arenas Where the BasicDCELs of the other layouts are
+/// @param f What to call, with a BasicDCEL that has the vertices added and is not built yet
+/// @return What f returns
+template<class F> auto withLayout(DCEL& polygon, Coords policy, Winding winding, Arenas& arenas, F f);
+
+/// @brief Settings and outcome of decomposeMultiStart, which runs algorithm1 from many start vertices and keeps the best decomposition.
+/// More starts give fewer pieces for more time.
+/// @param starts Number of start vertices to try, spread evenly over the polygon, vertex 0 first. 1 is the plain decomposition
+/// @param budget Seconds after which no new start is tried, 0 for no limit. Vertex 0 is always tried
+/// @param prune Whether a run gives up as soon as it is sure to make more diagonals than the best finished run. The best run is then
+/// the one with the fewest diagonals, and the fewest pieces among those. Only diagonals have a lower bound a run can be given up on,
+/// there is none on the pieces merging leaves, and a run that ties the fewest diagonals never gives up, so the result does not
+/// depend on which runs happened to finish. Without prune every run finishes and the best one has the fewest pieces
+/// @param tried Number of runs started
+/// @param pruned Number of those runs that gave up
+/// @param start The start vertex of the decomposition we kept
+/// @param diagonals Number of diagonals algorithm1 made in that run
+/// @param pieces Number of pieces of that run after merging
+/// @param seconds Wall time of decomposeMultiStart
+class MultiStart {
+public:
+    int starts = 1;
+    double budget = 0;
+    bool prune = true;
+    int tried = 0;
+    int pruned = 0;
+    Id start = 0;
+    Id diagonals = 0;
+    Id pieces = 0;
+    double seconds = 0;
+};
+
+/// @brief The DCELs decomposeMultiStart runs the starts in, kept by its caller from one call to the next like the DCEL of a Worker, so
+/// that the runs of every polygon after the first reuse their storage
+/// @param runs The DCEL of the run in progress of every thread
+/// @param kept The DCEL of the best finished run of every thread. The best one of all trades places with the polygon, whose storage
+/// then stays here for the next call
+class StartArenas {
+public:
+    vector<DCEL> runs;
+    vector<DCEL> kept;
+};
+
+/// @brief Decomposes polygon files one after the other with its own DCEL and output buffer, which are reused for every file.
+/// @param polygon The DCEL that every polygon is read into, and built in when it is made of doubles in counter-clockwise order
+/// @param arenas The BasicDCELs that the polygons of the other layouts are built in
+/// @param writer The buffer the decomposition is formatted in
+/// @param stats What this worker did so far
+/// @param logMetrics Whether to add a line to stats.metricsLog for every polygon
+/// @param multiStart How many start vertices to try for every polygon, see MultiStart. It only applies to Engine::MP1
+/// @param startArenas The DCELs those starts run in
+/// @param startThreads Number of threads those starts run on
+/// @param engine How to decompose every polygon
+/// @param cache Where decompositions are looked up before they are made and kept afterwards, nullptr for none
+/// @param key The key of the polygon being decomposed, kept to reuse its storage
+class Worker {
+public:
+    DCEL polygon;
+    Arenas arenas;
+    OutputWriter writer;
+    BatchStats stats;
+    bool logMetrics = false;
+    MultiStart multiStart;
+    StartArenas startArenas;
+    int startThreads = 1;
+    Engine engine = Engine::MP1;
+    ResultCache* cache = nullptr;
+    CacheKey key;
+
+    /// @brief Reads the polygon of job.input, decomposes it and writes the faces to job.output, followed by the time the decomposition took
+    /// @param job The job to run
+    /// @return false if one of the files could not be opened
+    bool run(const Job& job);
+
+    /// @brief The part of run after reading: looks the polygon up in the cache, decomposes it if it is not there and writes it out
+    /// @param job The job to run
+    /// @param polygon The DCEL or BasicDCEL the polygon is decomposed in, with its vertices added and not built yet
+    /// @param st1 When run started, for the read time
+    /// @param mirrored Whether polygon is a clockwise polygon whose x-coordinates were negated, they are negated back before writing
+    /// @return false if the output file could not be written
+    template<class D> bool finish(const Job& job, D& polygon, double st1, bool mirrored);
+};
+
+/// @brief Runs all the jobs of a batch on a pool of threads with work stealing
+/// @param jobs The jobs to run
+/// @param threads Number of worker threads
+/// @param stats Set to what all the workers did
+/// @param logMetrics Whether to log the Metrics of every polygon to stats.metricsLog
+/// @param multiStart How many start vertices to try for every polygon. Each polygon runs them on its own worker, and on the threads
+/// that have no polygon of their own when there are fewer polygons than threads
+/// @param engine How to decompose every polygon
+/// @param cache The cache all the workers share, nullptr for none
+/// @return false if a job failed
+bool runBatch(const vector<Job>& jobs, int threads, BatchStats& stats, bool logMetrics = false, const MultiStart& multiStart = MultiStart(),
+              Engine engine = Engine::MP1, ResultCache* cache = nullptr);
+
+/// @brief Makes the jobs for every polygon file of a directory, or of a manifest with one "<input> [<output>]" per line
+/// @param source The directory or the manifest
+/// @param outputDir Folder the outputs go to, for the polygons that have no output of their own
+/// @param jobs The jobs are appended here
+/// @return false if the manifest could not be read
+bool collectJobs(const filesystem::path& source, const filesystem::path& outputDir, vector<Job>& jobs);
+
+/// @brief Entry point of the batch mode, see printUsage() for its arguments
+/// @return The exit code of the program
+int batchMain(int argc, char** argv);
+
+/// @brief Entry point of "daa pack", which converts text polygon files to one binary container
+/// @return The exit code of the program
+int packMain(int argc, char** argv);
+
+/// @brief Entry point of "daa unpack", which converts a binary container back to text files
+/// @return The exit code of the program
+int unpackMain(int argc, char** argv);
+
+/// @brief Checks if the segment between two vertices of a polygon is a diagonal of it, that is if it lies inside the polygon
+/// and only touches its boundary at its two ends. O(k) for a polygon of k vertices
+/// @param P The coordinates of the vertices
+/// @param poly The polygon, as the ids of its vertices in P in counter-clockwise order
+/// @param a Position of one end in poly
+/// @param b Position of the other end in poly
+/// @return true if it is a diagonal
+bool isDiagonal(const vector<Vertex>& P, const vector<Id>& poly, size_t a, size_t b);
+
+/// @brief Finds a vertex that is visible from a vertex of a polygon, in about a given direction. We shoot a ray from a in that
+/// direction and take the first edge it hits. If nothing else is in the triangle of a, the hit point and one end of that edge,
+/// that end is visible from a, otherwise the vertex in the triangle at the smallest angle from the ray is. O(k)
+/// @param P The coordinates of the vertices
+/// @param poly The polygon, as the ids of its vertices in P in counter-clockwise order
+/// @param a Position in poly of the vertex we look from
+/// @param rx X of the direction of the ray
+/// @param ry Y of the direction of the ray
+/// @return Position in poly of the vertex we found, poly.size() if the ray does not start inside the polygon
+size_t visibleFrom(const vector<Vertex>& P, const vector<Id>& poly, size_t a, double rx, double ry);
+
+/// @brief Cuts a polygon along diagonals into parts with about the same number of vertices each. A part is cut in two by a
+/// diagonal found with visibleFrom whose two sides both have at least an eighth of its vertices, and parts where we find no
+/// such diagonal after a few tries are left whole
+/// @param P The coordinates of the vertices, in counter-clockwise order
+/// @param count Number of parts we want
+/// @param parts The parts, as the ids of their vertices in P in counter-clockwise order
+/// @param seams The diagonals we cut along
+void cutPolygon(const vector<Vertex>& P, int count, vector<vector<Id>>& parts, vector<pair<Id,Id>>& seams);
+
+/// @brief Decomposes a polygon by cutting it into parts with cutPolygon, running algorithm1 and merging on every part
+/// concurrently in a DCEL of its own, stitching the diagonals of the parts and the seams into polygon and merging across the seams
+/// @param polygon The DCEL, with the vertices of the polygon added and not built yet. It holds the decomposition afterwards
+/// @param count Number of parts to cut the polygon into
+/// @param threads Number of threads to run the parts on
+/// @return Number of parts the polygon was really cut into
+int decomposeParallel(DCEL& polygon, int count, int threads);
+
+/// @brief Entry point of "daa parallel", which decomposes one big polygon on many cores, see printUsage()
+/// @return The exit code of the program
+int parallelMain(int argc, char** argv);
+
+/// @brief Decomposes a polygon from multiple.starts start vertices at once, each run in a DCEL of its own, and keeps the best
+/// decomposition. The runs share the number of diagonals of the best finished run in an atomic, which algorithm1 uses to give up early
+/// @param polygon The DCEL, with the vertices of the polygon added and not built yet. It holds the best decomposition afterwards
+/// @param threads Number of threads to run the starts on
+/// @param multiStart The settings, the outcome is written to it
+/// @param arenas The DCELs the runs are made in
+void decomposeMultiStart(DCEL& polygon, int threads, MultiStart& multiStart, StartArenas& arenas);
+
+/// @brief Shapes of the polygons the benchmark generates, all of them simple and counter-clockwise
+enum class Shape { Random, Star, Comb, Spiral, NearlyConvex };
+
+/// @brief Names of the shapes, in the order of Shape, as they are given on the command line and written to the results
+const char* const SHAPE_NAMES[] = {"random", "star", "comb", "spiral", "convex"};
+
+/// @brief Generates a polygon for the benchmark, the same seed gives the same polygon on every build
+///   random  x-monotone polygon through uniform random points, the points above the line between the leftmost and rightmost one form the upper chain
+///   star    random angles around the origin with a random radius each, about half of the vertices are notches
+///   comb    a base with narrow teeth of random height, every gap between two teeth is a notch
+///   spiral  a thin band wound around the origin, every vertex of its inner side is a notch
+///   convex  a circle with 1% of its vertices pulled slightly inwards, which makes each of them a notch
+/// @param shape The shape
+/// @param n Number of vertices
+/// @param seed Seed of the random generator
+/// @param polygon The vertices are written here
+void generatePolygon(Shape shape, int n, uint64_t seed, vector<Vertex>& polygon);
+
+/// @brief Removes the vertices that lie on the line through their two neighbours, which takes repeated vertices and spikes with
+/// them. Rounding a polygon to a coarse grid makes many of those. Every removal rechecks the two neighbours, so it runs in O(n)
+/// @param polygon The vertices of the polygon, fewer than 3 may be left
+void dropDegenerate(vector<Vertex>& polygon);
+
+/// @brief Checks that no two edges of a polygon meet, other than consecutive edges at the vertex they share, in O(n log n). A line
+/// sweeps the polygon from left to right, and every edge is only tested against the edges directly above and below it on that line
+/// @param polygon The vertices of the polygon, with no repeated vertices or collinear runs, see dropDegenerate
+/// @return true if the polygon is simple
+bool isSimple(const vector<Vertex>& polygon);
+
+/// @brief Timings of one benchmark case, the same polygon decomposed a number of times
+/// @param shape Shape of the polygon
+/// @param engine The engine that was asked for
+/// @param coords The coordinate policy of the BasicDCEL it ran on, always Double for the engines other than mp1
+/// @param used The engine that ran, mp1 or hm
+/// @param n Number of vertices
+/// @param notches Number of notches of the polygon
+/// @param pieces Number of convex pieces after merging
+/// @param partition Seconds of every repetition of the engine before merging, DCEL::algorithm1 or DCEL::triangulate, after reset and build
+/// @param merging Seconds of every repetition of DCEL::merging
+/// @param metrics Metrics of the last repetition
+/// @param multiStarts The outcome of decomposeMultiStart for every number of starts of --starts
+/// @param updates Seconds of every edit of --edits that DCEL::update applied to the decomposition of the last repetition
+/// @param editPieces Number of pieces after those edits
+/// @param recompute Seconds of decomposing the edited polygon again from scratch with the same engine, build included
+/// @param recomputePieces Number of pieces of that decomposition
+/// @param flips Number of those edits that turned a notch into a convex vertex or back
+/// @param failures Number of those edits after which checkDecomposition found the decomposition wrong, with --verify
+/// @param extraPieces Most pieces the update had over build, algorithm1 and merging on the same edited polygon, with --verify
+class BenchCase {
+public:
+    Shape shape = Shape::Random;
+    Engine engine = Engine::MP1;
+    Coords coords = Coords::Double;
+    Engine used = Engine::MP1;
+    int n = 0;
+    int notches = 0;
+    int pieces = 0;
+    vector<double> partition;
+    vector<double> merging;
+    Metrics metrics;
+    vector<MultiStart> multiStarts;
+    vector<double> updates;
+    int editPieces = 0;
+    double recompute = 0;
+    int recomputePieces = 0;
+    int flips = 0;
+    int failures = 0;
+    int extraPieces = 0;
+};
+
+/// @brief Applies random edits to a decomposed polygon one at a time with DCEL::update, and then decomposes the edited polygon
+/// from scratch to compare. Vertices are moved towards the middle of their neighbours and up to half as far past it, which turns
+/// a notch into a convex vertex or back, new vertices are put next to the middle of an edge and vertices are deleted, in equal
+/// parts. An edit that would make the polygon cross itself is skipped, which we find out by testing its new edges against the
+/// whole polygon before the update, outside of the timings
+/// @param polygon The decomposed polygon, it is edited
+/// @param engine The engine for the decomposition from scratch
+/// @param count Number of edits to try
+/// @param seed Seed of the random generator
+/// @param verify Whether to check the decomposition after every update with checkDecomposition, and against build, algorithm1
+/// and merging on the edited polygon, outside of the timings
+/// @param result updates, editPieces, recompute, recomputePieces and flips are filled in, and failures and extraPieces with verify
+void benchEdits(DCEL& polygon, Engine engine, int count, uint64_t seed, bool verify, BenchCase& result);
+
+/// @brief Checks a decomposition without trusting how it was made: the half-edges of every piece are linked both ways and meet
+/// end to end, every piece is convex, every edge of the polygon is in exactly one piece, the areas of the pieces add up to the
+/// area of the polygon, and there are at most 2r+1 pieces for r notches, which holds once no diagonal can be removed
+/// @param polygon The decomposed polygon, DCEL::update may have edited it
+/// @return What is wrong, empty if nothing is
+string checkDecomposition(const DCEL& polygon);
+
+/// @brief Times orient against the plain sign of its determinant in doubles, on random triples of points and on triples whose third
+/// point is put on the line through the first two and rounded, there and a billion units away, and counts how often the plain sign is
+/// wrong and how often orient needs orientExact
+/// @param count Number of triples of each set
+/// @param seed Seed of the random generator
+void benchPredicates(int count, uint64_t seed);
+
+/// @brief Finds a percentile of some timings with the nearest-rank method
+/// @param sorted The timings, sorted
+/// @param p The percentile, between 0 and 100
+/// @return The timing
+double percentile(const vector<double>& sorted, double p);
+
+/// @brief Entry point of "daa bench", which times the engines and DCEL::merging on generated polygons
+/// @return The exit code of the program
+int benchMain(int argc, char** argv);
+
+/// @brief Header of every message to and from daa serve, followed by length bytes of body. Clients send frames of kind
+/// SERVICE_DECOMPOSE with a polygon record as body, laid out as in a container of kind BINARY_POLYGONS, see BinaryHeader, or of kind
+/// SERVICE_STATS with no body. Every frame gets one reply with the same tag: SERVICE_DECOMPOSE with the decomposition record, laid out
+/// as in a container of kind BINARY_DECOMPOSITIONS, SERVICE_STATS with a JSON object of ServiceStats, or SERVICE_ERROR with a message.
+/// Like the binary containers everything is little-endian, and every body is a multiple of 8 bytes except the text of the last two
+/// @param kind SERVICE_DECOMPOSE, SERVICE_STATS or SERVICE_ERROR
+/// @param length Length of the body in bytes, at most SERVICE_MAX_BYTES
+/// @param tag Chosen by the client to match the replies to its requests, which may come back in another order, see serveMain
+class ServiceFrame {
+public:
+    uint32_t kind;
+    uint32_t length;
+    uint64_t tag;
+};
+
+static_assert(sizeof(ServiceFrame) == 16, "the service frames are written as they are laid out in memory");
+
+/// @brief Kind of a frame that asks for, or holds, the decomposition of a polygon
+const uint32_t SERVICE_DECOMPOSE = 1;
+
+/// @brief Kind of a frame that asks for, or holds, the numbers of the server
+const uint32_t SERVICE_STATS = 2;
+
+/// @brief Kind of a reply to a frame that could not be served, its body says why
+const uint32_t SERVICE_ERROR = 3;
+
+/// @brief Most vertices of a polygon daa serve takes
+const uint32_t SERVICE_MAX_VERTICES = 1u << 22;
+
+/// @brief Largest body we read, the record of a polygon of SERVICE_MAX_VERTICES vertices with a name of up to 4 KiB. A longer one
+/// ends the connection since its bytes could not be skipped in time
+const uint32_t SERVICE_MAX_BYTES = 8 + 4096 + 16 * SERVICE_MAX_VERTICES;
+
+/// @brief Number of the latest replies whose latency ServiceStats keeps for its percentiles
+const size_t LATENCY_WINDOW = 1 << 16;
+
+/// @brief Reads a stream through a buffer, so that the small frames of many requests take one read() together
+/// @param fd The descriptor it reads from
+/// @param buffer Bytes read but not handed out yet, from begin to end
+class FrameReader {
+public:
+    int fd;
+    vector<char> buffer = vector<char>(1 << 16);
+    size_t begin = 0;
+    size_t end = 0;
+
+    /// @brief Reads exactly len bytes, big ones straight into out
+    /// @param out Where they go
+    /// @param len Number of bytes
+    /// @return false if the stream ended or failed before that
+    bool read(void* out, size_t len);
+};
+
+/// @brief Writes all of a buffer to a descriptor, retrying short and interrupted writes
+/// @param fd The descriptor
+/// @param data The bytes
+/// @param len Number of bytes
+/// @return false if it failed, because the reader went away for one
+bool writeAll(int fd, const char* data, size_t len);
+
+/// @brief Adds up what daa serve did, for the replies to SERVICE_STATS. All the functions take the lock
+/// @param started steadySeconds() when the server started
+/// @param requests Frames read from all the connections
+/// @param errors Replies of kind SERVICE_ERROR
+/// @param rejected Requests turned away because the queue was full, with --overload reject
+/// @param work What the workers did, polygons, vertices, times and cache hits, added up before every reply
+/// @param latencies Seconds from reading a request to writing its reply, for the last LATENCY_WINDOW decompositions
+/// @param next Where the next latency goes in latencies once it holds LATENCY_WINDOW of them
+class ServiceStats {
+public:
+    mutex lock;
+    double started = 0;
+    uint64_t requests = 0;
+    uint64_t errors = 0;
+    uint64_t rejected = 0;
+    BatchStats work;
+    vector<double> latencies;
+    size_t next = 0;
+
+    /// @brief Keeps the latency of a reply
+    /// @param kind Kind of the reply, only decompositions are kept
+    /// @param latency Seconds from reading the request to writing the reply
+    void record(uint32_t kind, double latency);
+
+    /// @brief Formats the numbers and the percentiles of the latencies as a JSON object
+    /// @param queued Number of requests waiting for a worker
+    /// @return The JSON text
+    string json(size_t queued);
+};
+
+/// @brief A reply waiting to be written
+/// @param frame Its header
+/// @param body Its body
+/// @param arrived steadySeconds() when the request was read, for its latency
+class Reply {
+public:
+    ServiceFrame frame;
+    vector<char> body;
+    double arrived;
+};
+
+/// @brief One client of daa serve, on a Unix socket or on stdin and stdout. The requests are numbered as they are read, and with
+/// ordered replies a reply that is done before the ones of earlier requests waits in pending until they are written. The workers
+/// only add their replies to buffer, a thread of the connection's own writes it out with drain, so a client that does not read its
+/// replies only holds up itself: its reader stops reading requests while it has SERVICE_MAX_BYTES of replies unsent, see waitRoom.
+/// The writer keeps the connection until every reply is written, and the descriptors are closed with it
+/// @param in The descriptor requests are read from
+/// @param out The descriptor replies are written to, the same as in for a socket
+/// @param ordered Whether replies are written in the order of the requests, otherwise as soon as they are done
+/// @param stats Where the latencies go
+/// @param next Number of the request whose reply goes into buffer next, when ordered
+/// @param pending The replies that are done and wait for the ones before them, by number of request
+/// @param buffer The replies that are written with the next write()
+/// @param kinds Kind and arrival of every reply in buffer, for their latencies
+/// @param unsent Bytes of the replies in pending and buffer, and of those being written
+/// @param written Number of replies written, or dropped after a failed write
+/// @param total Number of replies there will be, known once finish is called
+/// @param broken Whether a write failed, the replies after that are dropped
+class Connection {
+public:
+    int in;
+    int out;
+    bool ordered = true;
+    ServiceStats* stats = nullptr;
+    mutex lock;
+    condition_variable ready;
+    condition_variable room;
+    uint64_t next = 0;
+    map<uint64_t, Reply> pending;
+    vector<char> buffer;
+    vector<pair<uint32_t, double>> kinds;
+    size_t unsent = 0;
+    uint64_t written = 0;
+    uint64_t total = UINT64_MAX;
+    bool broken = false;
+
+    Connection(int in, int out, bool ordered, ServiceStats* stats) : in(in), out(out), ordered(ordered), stats(stats) {}
+    Connection(const Connection&) = delete;
+    ~Connection();
+
+    /// @brief Hands the reply to a request to the writer, with those of the requests after it that were waiting for it. It never
+    /// waits for the client
+    /// @param sequence Number of the request on this connection
+    /// @param reply The reply
+    void send(uint64_t sequence, Reply&& reply);
+
+    /// @brief Tells the writer how many replies there are, once the reader read its last request
+    /// @param count Number of requests that got or will get a reply
+    void finish(uint64_t count);
+
+    /// @brief Waits until the unsent replies are less than SERVICE_MAX_BYTES, or the client went away
+    void waitRoom();
+
+    /// @brief Writes the replies as they come until all of them are written, on the writer thread of the connection
+    void drain();
+};
+
+/// @brief A request read from a connection, waiting in the RequestQueue for a worker
+/// @param connection Where it came from and where the reply goes
+/// @param sequence Its number on the connection
+/// @param tag The tag of its frame
+/// @param arrived steadySeconds() when it was read
+/// @param bytes The polygon record, and the decomposition record of the reply once it is decomposed
+class Request {
+public:
+    shared_ptr<Connection> connection;
+    uint64_t sequence;
+    uint64_t tag;
+    double arrived;
+    vector<char> bytes;
+};
+
+/// @brief Bounded queue of the requests of all the connections of daa serve. A worker takes a batch of requests at once, with one
+/// lock and one wakeup for all of them, but never more than its share of the queue, so batches only grow with the load and an idle
+/// worker is not left waiting behind a busy one
+/// @param depth Number of requests it holds at most, after that readers wait or turn requests away, see push
+/// @param workers Number of workers that take requests, the queue is shared among them
+/// @param requests The requests, the oldest first
+/// @param closed Whether no requests come anymore, the workers stop once it is empty
+class RequestQueue {
+public:
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+    size_t depth;
+    size_t workers;
+    deque<Request> requests;
+    bool closed = false;
+
+    RequestQueue(size_t depth, size_t workers) : depth(depth), workers(workers) {}
+
+    /// @brief Adds a request
+    /// @param request The request, it is moved from only when it was added
+    /// @param wait Whether to wait while the queue is full, otherwise the request is turned away
+    /// @return false if it was turned away
+    bool push(Request& request, bool wait);
+
+    /// @brief Takes the oldest requests, waiting until there is one
+    /// @param batch Cleared and filled with the requests
+    /// @param most Number of requests to take at most
+    /// @return false if the queue is closed and empty
+    bool pop(vector<Request>& batch, size_t most);
+
+    /// @brief Lets the workers stop once the queue is empty
+    void close();
+
+    /// @brief Counts the requests waiting
+    /// @return The number of them
+    size_t size();
+};
+
+/// @brief Reads the frames of a connection until it ends, hands the polygons to the workers and answers SERVICE_STATS itself. At the
+/// end it tells the connection how many replies there are, see Connection::finish
+/// @param connection The connection
+/// @param queue Where the polygons go
+/// @param stats The numbers of the server
+/// @param wait Whether to wait while the queue is full, see RequestQueue::push
+void serveConnection(const shared_ptr<Connection>& connection, RequestQueue& queue, ServiceStats& stats, bool wait);
+
+/// @brief Entry point of "daa serve", which decomposes the polygons of requests on stdin or a Unix socket until it is stopped
+/// @return The exit code of the program
+int serveMain(int argc, char** argv);
+
+/// @brief Entry point of "daa load", which sends generated polygons to daa serve and measures its latency and throughput
+/// @return The exit code of the program
+int loadMain(int argc, char** argv);
+
+bool JobQueue::pop(size_t& job){
+    lock_guard<mutex> guard(this->lock);
+    if(this->jobs.empty()) return false;
+    job = this->jobs.back();
+    this->jobs.pop_back();
+    return true;
+}
+
+bool JobQueue::steal(size_t& job){
+    lock_guard<mutex> guard(this->lock);
+    if(this->jobs.empty()) return false;
+    job = this->jobs.front();
+    this->jobs.pop_front();
+    return true;
+}
+
+/// @brief Reads the CPU clock of the calling thread
+/// @return The CPU time of the thread in seconds
+double threadSeconds(){
+    struct timespec ts={0,0};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts); // with several workers the process clock would add up all of their time
+    return ts.tv_sec + ts.tv_nsec / 1.0e9;
+}
+
+bool readPolygon(const string& path, DCEL& polygon){
+    polygon.reset();
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) < 0 or st.st_size == 0){
+        close(fd);
+        return false;
+    }
+    size_t len = st.st_size;
+    void* map = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping stays valid after the descriptor is closed
+    if(map == MAP_FAILED) return false;
+    madvise(map, len, MADV_SEQUENTIAL);
+
+    const char* p = (const char*)map, *end = p + len;
+    auto skip = [&](){ // skips the whitespace and a leading '+', which from_chars does not accept
+        while(p < end and (isspace((unsigned char)*p) or *p == '+')) p++;
+    };
+    bool ok = true;
+    int siz = 0;
+    skip();
+    from_chars_result r = from_chars(p, end, siz);
+    if(r.ec != errc() or siz < 3) ok = false;
+    p = r.ptr;
+    if(ok and siz > (end - p) / 4) ok = false; // every vertex takes 4 bytes at least, a space and a digit for each of x and y
+    if(ok) polygon.vertices.reserve(siz);
+    for(int i = 0; i < siz and ok; ++i)
+    {
+        double x,y;
+        skip();
+        r = from_chars(p, end, x);
+        p = r.ptr;
+        skip();
+        from_chars_result r2 = from_chars(p, end, y);
+        p = r2.ptr;
+        if(r.ec != errc() or r2.ec != errc()) ok = false;
+        else polygon.addVertex(x,y);
+    }
+    munmap(map, len);
+    return ok;
+}
+
+void OutputWriter::put(double x){
+    if(this->buffer.size() < this->used + 32) this->buffer.resize(max<size_t>(2 * this->buffer.size(), 1 << 16));
+    char* out = this->buffer.data() + this->used;
+
+    // fast path for the fixed notation, when x rounds to 6 digits with an exponent from -4 to 5: we scale it to the 6 digit integer
+    // and print that. The scaling is off by far less than 1e-6, so we only hand x to to_chars when it is that close to a tie
+    static const double pow10[] = {1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    double a = fabs(x);
+    if(a >= 1e-4 and a < 999999.5){
+        int X = 5;
+        while(X > -4 and a < pow10[X + 4] / 1e4) X--; // 10^X <= a, up to the rounding of the powers below 1
+        double m = a * pow10[5 - X];
+        double fl = floor(m);
+        if(m >= 99999.5 and fabs(m - fl - 0.5) > 1e-6){
+            long long r = (long long)fl + (m - fl > 0.5);
+            if(r == 1000000){ // rounding carried into a 7th digit
+                r = 100000;
+                X++;
+            }
+            if(X <= 5){
+                char digits[6];
+                for(int i = 5; i >= 0; i--, r /= 10) digits[i] = '0' + r % 10;
+                int last = 5; // the last digit we print, trailing zeros after the point are dropped
+                while(last > X and last > 0 and digits[last] == '0') last--;
+                char* p = out;
+                if(x < 0) *p++ = '-';
+                if(X < 0){
+                    *p++ = '0';
+                    *p++ = '.';
+                    for(int i = -1; i > X; i--) *p++ = '0';
+                    for(int i = 0; i <= last; i++) *p++ = digits[i];
+                }
+                else{
+                    for(int i = 0; i <= X; i++) *p++ = digits[i];
+                    if(last > X){
+                        *p++ = '.';
+                        for(int i = X + 1; i <= last; i++) *p++ = digits[i];
+                    }
+                }
+                this->used = p - this->buffer.data();
+                return;
+            }
+        }
+    }
+    to_chars_result r = to_chars(out, this->buffer.data() + this->buffer.size(), x, chars_format::general, 6);
+    this->used = r.ptr - this->buffer.data();
+}
+
+void OutputWriter::put(const char* text, size_t len){
+    if(this->buffer.size() < this->used + len) this->buffer.resize(max(2 * this->buffer.size(), this->used + len));
+    memcpy(this->buffer.data() + this->used, text, len);
+    this->used += len;
+}
+
+template<class D> void OutputWriter::putFaces(const D& polygon){
+    for(Id f = 0; f < polygon.faces.size(); f++){
+        if(!polygon.LDP[f]) continue;
+        Id e = polygon.faces[f].outerComponent, start = e;
+        do{
+            const auto& p = polygon.vertices[polygon.halfEdges[e].origin];
+            this->put(p.x);
+            this->put(", ", 2);
+            this->put(p.y);
+            this->put("\n", 1);
+            e = polygon.halfEdges[e].next;
+        } while(e!=start);
+        this->put("\n", 1);
+    }
+}
+
+bool OutputWriter::save(const string& path){
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(fd < 0) return false;
+    size_t done = 0;
+    while(done < this->used){
+        ssize_t w = write(fd, this->buffer.data() + done, this->used - done);
+        if(w <= 0) break;
+        done += w;
+    }
+    close(fd);
+    bool ok = done == this->used;
+    this->used = 0;
+    return ok;
+}
+
+/// @brief Appends the bytes of a value to a buffer
+/// @param out The buffer
+/// @param value The value
+template<class T> void append(vector<char>& out, const T& value){
+    const char* p = (const char*)&value;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+/// @brief Appends a name and pads the buffer to a multiple of 8 bytes
+/// @param out The buffer
+/// @param name The name
+void appendName(vector<char>& out, const string& name){
+    out.insert(out.end(), name.begin(), name.end());
+    out.resize((out.size() + 7) / 8 * 8, 0);
+}
+
+BinaryFile::~BinaryFile(){
+    if(this->data) munmap((void*)this->data, this->length);
+}
+
+bool BinaryFile::open(const string& path){
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) return false;
+    struct stat st;
+    if(fstat(fd, &st) < 0 or (size_t)st.st_size < sizeof(BinaryHeader)){
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return false;
+    this->data = (const char*)map;
+    this->length = st.st_size;
+
+    memcpy(&this->header, this->data, sizeof(BinaryHeader));
+    if(memcmp(this->header.magic, "DCEL", 4) != 0 or this->header.version != BINARY_VERSION) return false;
+    if(this->header.kind != BINARY_POLYGONS and this->header.kind != BINARY_DECOMPOSITIONS and this->header.kind != BINARY_CACHE) return false;
+    size_t table = sizeof(BinaryHeader) + (this->header.records + 1ull) * sizeof(uint64_t);
+    if(table > this->length) return false;
+    this->offsets = (const uint64_t*)(this->data + sizeof(BinaryHeader));
+    if(this->offsets[this->header.records] > this->length) return false;
+    size_t fixed = this->header.kind == BINARY_DECOMPOSITIONS ? 24 : 8; // the fields before the name, see name()
+    for(uint32_t i = 0; i < this->header.records; i++){ // every record has to lie in the file, in order, start aligned and hold its fields and name
+        if(this->offsets[i] < table or this->offsets[i] % 8 != 0 or this->offsets[i] > this->offsets[i+1]) return false;
+        uint64_t size = this->offsets[i+1] - this->offsets[i];
+        if(size < fixed or (fixed + this->field(i, 1) + 7) / 8 * 8 > size) return false; // so body() never points past the record
+    }
+    return true;
+}
+
+uint32_t BinaryFile::field(uint32_t record, int field) const{
+    uint32_t value;
+    memcpy(&value, this->data + this->offsets[record] + 4 * field, 4);
+    return value;
+}
+
+string BinaryFile::name(uint32_t record) const{
+    int fields = this->header.kind == BINARY_DECOMPOSITIONS ? 6 : 2; // a decomposition has 4 uint32 and a double before its name
+    const char* p = this->data + this->offsets[record] + 4 * fields;
+    size_t len = min<size_t>(this->field(record, 1), this->data + this->offsets[record+1] - p);
+    return string(p, len);
+}
+
+const char* BinaryFile::body(uint32_t record) const{
+    int fields = this->header.kind == BINARY_DECOMPOSITIONS ? 6 : 2;
+    return this->data + this->offsets[record] + (4 * fields + this->field(record, 1) + 7) / 8 * 8;
+}
+
+bool isBinary(const string& path){
+    char magic[4] = {0};
+    ifstream in(path, ios::binary);
+    in.read(magic, 4);
+    return in and memcmp(magic, "DCEL", 4) == 0;
+}
+
+bool loadPolygon(const BinaryFile& file, uint32_t record, DCEL& polygon){
+    polygon.reset();
+    if(file.header.kind != BINARY_POLYGONS or record >= file.header.records) return false;
+    return decodePolygon(file.data + file.offsets[record], file.offsets[record+1] - file.offsets[record], polygon);
+}
+
+bool decodePolygon(const char* record, size_t length, DCEL& polygon){
+    polygon.reset();
+    if(length < 8) return false;
+    uint32_t n, len;
+    memcpy(&n, record, 4);
+    memcpy(&len, record + 4, 4);
+    size_t body = (8ull + len + 7) / 8 * 8;
+    if(n < 3 or body + 16ull * n > length) return false;
+    const char* p = record + body;
+    polygon.vertices.reserve(n);
+    for(uint32_t i = 0; i < n; i++, p += 16){
+        double xy[2];
+        memcpy(xy, p, 16);
+        polygon.addVertex(xy[0], xy[1]);
+    }
+    return true;
+}
+
+string recordName(const char* record, size_t length){
+    if(length < 8) return "";
+    uint32_t len;
+    memcpy(&len, record + 4, 4);
+    return string(record + 8, min<size_t>(len, length - 8));
+}
+
+void encodePolygon(const DCEL& polygon, const string& name, vector<char>& out){
+    append<uint32_t>(out, polygon.vertices.size());
+    append<uint32_t>(out, name.size());
+    appendName(out, name);
+    for(const Vertex& v: polygon.vertices){
+        append(out, v.x);
+        append(out, v.y);
+    }
+}
+
+template<class D> void encodeDecomposition(const D& polygon, const string& name, double seconds, vector<char>& out){
+    const vector<HalfEdge>& he = polygon.halfEdges;
+    uint32_t pieces = 0, diagonals = 0;
+    for(Id f = 0; f < polygon.faces.size(); f++) pieces += polygon.LDP[f];
+    for(Id d: polygon.diags) diagonals += he[he[d].prev].next == d; // merging splices the removed diagonals out of their faces
+
+    append<uint32_t>(out, polygon.vertices.size());
+    append<uint32_t>(out, name.size());
+    append(out, pieces);
+    append(out, diagonals);
+    append(out, seconds);
+    appendName(out, name);
+    for(Id d: polygon.diags){
+        if(he[he[d].prev].next != d) continue;
+        append(out, he[d].origin);
+        append(out, he[he[d].twin].origin);
+    }
+    size_t starts = out.size(); // we fill in the starts of the pieces while we write out their vertices
+    out.resize(starts + 4 * (pieces + 1));
+    uint32_t at = 0, piece = 0;
+    for(Id f = 0; f < polygon.faces.size(); f++){
+        if(!polygon.LDP[f]) continue;
+        memcpy(out.data() + starts + 4 * piece++, &at, 4);
+        Id e = polygon.faces[f].outerComponent, start = e;
+        do{
+            append(out, he[e].origin);
+            at++;
+            e = he[e].next;
+        } while(e!=start);
+    }
+    memcpy(out.data() + starts + 4 * piece, &at, 4);
+    out.resize((out.size() + 7) / 8 * 8, 0);
+}
+
+bool decodeDecomposition(const BinaryFile& file, uint32_t record, const BinaryFile& polygons, uint32_t polygonRecord, OutputWriter& writer){
+    if(file.header.kind != BINARY_DECOMPOSITIONS or polygons.header.kind != BINARY_POLYGONS) return false;
+    if(record >= file.header.records or polygonRecord >= polygons.header.records) return false;
+    uint32_t n = file.field(record, 0), pieces = file.field(record, 2), diagonals = file.field(record, 3);
+    if(n != polygons.field(polygonRecord, 0)) return false;
+    const char* coords = polygons.body(polygonRecord);
+    if(16ull * n > (size_t)(polygons.data + polygons.offsets[polygonRecord+1] - coords)) return false;
+    // we bound the counts by the bytes the record has before we allocate or read anything, the pieces and diagonals of a damaged
+    // file can be anything up to UINT32_MAX
+    const char* body = file.body(record), *end = file.data + file.offsets[record+1];
+    size_t left = end - body, count = (size_t)pieces + 1;
+    if(8ull * diagonals > left or 4 * count > left - 8ull * diagonals) return false;
+    const char* starts = body + 8ull * diagonals;
+    vector<uint32_t> start(count);
+    memcpy(start.data(), starts, 4 * count);
+    const char* ids = starts + 4 * count;
+    for(uint32_t i = 0; i < pieces; i++) if(start[i] > start[i+1]) return false;
+    if(start[pieces] > (size_t)(end - ids) / 4) return false;
+
+    for(uint32_t i = 0; i < pieces; i++){
+        for(uint32_t j = start[i]; j < start[i+1]; j++){
+            uint32_t v;
+            memcpy(&v, ids + 4ull * j, 4);
+            if(v >= n) return false;
+            double xy[2];
+            memcpy(xy, coords + 16ull * v, 16);
+            writer.put(xy[0]);
+            writer.put(", ", 2);
+            writer.put(xy[1]);
+            writer.put("\n", 1);
+        }
+        writer.put("\n", 1);
+    }
+    double seconds;
+    memcpy(&seconds, file.data + file.offsets[record] + 16, 8);
+    writer.put(seconds);
+    writer.put("\n", 1);
+    return true;
+}
+
+bool writeBinary(const string& path, uint16_t kind, const vector<vector<char>>& records){
+    vector<char> head;
+    BinaryHeader header;
+    memcpy(header.magic, "DCEL", 4);
+    header.version = BINARY_VERSION;
+    header.kind = kind;
+    header.records = records.size();
+    header.reserved = 0;
+    append(head, header);
+    uint64_t at = sizeof(BinaryHeader) + (records.size() + 1) * sizeof(uint64_t);
+    for(const vector<char>& r: records){
+        append(head, at);
+        at += r.size();
+    }
+    append(head, at);
+
+    ofstream out(path, ios::binary);
+    out.write(head.data(), head.size());
+    for(const vector<char>& r: records) out.write(r.data(), r.size());
+    return (bool)out;
+}
+
+void CacheKey::make(const DCEL& polygon, const string& tag){
+    const vector<Vertex>& P = polygon.vertices;
+    size_t n = P.size();
+    this->tag = tag;
+    this->start = 0;
+    for(size_t i = 1; i < n; i++){
+        if(P[i].y < P[this->start].y or (P[i].y == P[this->start].y and P[i].x < P[this->start].x)) this->start = i;
+    }
+    this->coords.resize(2 * n);
+    uint64_t h = 0xcbf29ce484222325ull ^ n;
+    for(char c: tag) h = (h ^ (unsigned char)c) * 0x100000001b3ull;
+    const Vertex& o = P[this->start];
+    for(size_t i = 0, v = this->start; i < n; i++, v = v + 1 == n ? 0 : v + 1){
+        this->coords[2*i] = P[v].x - o.x;
+        this->coords[2*i+1] = P[v].y - o.y;
+        for(int k = 0; k < 2; k++){ // we mix in the bits of both doubles, a word at a time
+            uint64_t bits;
+            memcpy(&bits, &this->coords[2*i+k], 8);
+            h = (h ^ bits) * 0x9e3779b97f4a7c15ull;
+            h ^= h >> 32;
+        }
+    }
+    this->hash = h;
+}
+
+size_t CacheKey::bytes(size_t diagonals) const{
+    return sizeof(CacheEntry) + this->tag.size() + this->coords.size() * sizeof(double) + diagonals * 2 * sizeof(Id);
+}
+
+bool ResultCache::open(size_t budget, const string& path){
+    this->budget = budget;
+    this->path = path;
+    if(path.empty() or !filesystem::exists(path)) return true;
+    if(!this->disk.open(path) or this->disk.header.kind != BINARY_CACHE) return false;
+    CacheKey key;
+    for(uint32_t i = 0; i < this->disk.header.records; i++){ // we hash the keys again, so the file does not need to store them
+        uint32_t n = this->disk.field(i, 0);
+        const char* p = this->disk.body(i);
+        if(n < 3 or p + 16ull * n + 16 > this->disk.data + this->disk.offsets[i+1]) return false;
+        DCEL polygon;
+        for(uint32_t v = 0; v < n; v++, p += 16){
+            double xy[2];
+            memcpy(xy, p, 16);
+            polygon.addVertex(xy[0], xy[1]);
+        }
+        key.make(polygon, this->disk.name(i));
+        this->diskIndex.emplace(key.hash, i);
+    }
+    return true;
+}
+
+template<class D> CacheTier ResultCache::find(const CacheKey& key, D& polygon, double& seconds){
+    vector<pair<Id,Id>> diagonals;
+    size_t n = key.coords.size() / 2;
+    auto found = [&](const vector<Id>& pairs){ // the indices count from key.start
+        for(size_t i = 0; i + 1 < pairs.size(); i += 2) diagonals.push_back({(pairs[i] + key.start) % n, (pairs[i+1] + key.start) % n});
+    };
+    CacheTier tier = CacheTier::None;
+    {
+        lock_guard<mutex> guard(this->lock);
+        auto [from, to] = this->index.equal_range(key.hash);
+        for(auto it = from; it != to and tier == CacheTier::None; it++){
+            const CacheEntry& e = *it->second;
+            if(e.key.tag != key.tag or e.key.coords != key.coords) continue;
+            this->entries.splice(this->entries.begin(), this->entries, it->second); // it is now the entry used last
+            found(e.diagonals);
+            seconds = e.seconds;
+            tier = CacheTier::Memory;
+        }
+        auto [first, last] = this->diskIndex.equal_range(key.hash);
+        for(auto it = first; it != last and tier == CacheTier::None; it++){
+            uint32_t r = it->second;
+            const char* p = this->disk.body(r);
+            if(this->disk.field(r, 0) != n or this->disk.name(r) != key.tag or memcmp(p, key.coords.data(), 16 * n) != 0) continue;
+            p += 16 * n;
+            uint32_t count;
+            memcpy(&seconds, p, 8);
+            memcpy(&count, p + 8, 4);
+            p += 16;
+            if(p + 8ull * count > this->disk.data + this->disk.offsets[r+1]) continue;
+            CacheEntry entry{key, vector<Id>(2 * count), seconds};
+            memcpy(entry.diagonals.data(), p, 8ull * count);
+            found(entry.diagonals);
+            this->remember(move(entry)); // it moves up to the memory tier
+            tier = CacheTier::Disk;
+        }
+    }
+    if(tier == CacheTier::None) return tier;
+    polygon.build();
+    polygon.addDiagonals(diagonals);
+    polygon.merging(diagonals.size()); // the diagonals are the ones merging kept, there is nothing left to merge
+    return tier;
+}
+
+template<class D> void ResultCache::insert(const CacheKey& key, const D& polygon, double seconds){
+    const vector<HalfEdge>& he = polygon.halfEdges;
+    size_t n = key.coords.size() / 2;
+    CacheEntry entry{key, {}, seconds};
+    for(Id d: polygon.diags){
+        if(he[he[d].prev].next != d) continue; // merged away
+        entry.diagonals.push_back((he[d].origin + n - key.start) % n);
+        entry.diagonals.push_back((he[he[d].twin].origin + n - key.start) % n);
+    }
+    vector<char> record;
+    if(!this->path.empty()){
+        append<uint32_t>(record, n);
+        append<uint32_t>(record, key.tag.size());
+        appendName(record, key.tag);
+        record.insert(record.end(), (const char*)key.coords.data(), (const char*)(key.coords.data() + 2 * n));
+        append(record, seconds);
+        append<uint32_t>(record, entry.diagonals.size() / 2);
+        append<uint32_t>(record, 0);
+        record.insert(record.end(), (const char*)entry.diagonals.data(), (const char*)(entry.diagonals.data() + entry.diagonals.size()));
+    }
+
+    lock_guard<mutex> guard(this->lock);
+    auto [from, to] = this->index.equal_range(key.hash);
+    for(auto it = from; it != to; it++){ // another worker may have decomposed the same polygon meanwhile
+        if(it->second->key.tag == key.tag and it->second->key.coords == key.coords) return;
+    }
+    if(!record.empty()) this->added.push_back(move(record));
+    this->remember(move(entry));
+}
+
+void ResultCache::remember(CacheEntry&& entry){
+    size_t size = entry.key.bytes(entry.diagonals.size());
+    if(size > this->budget) return;
+    uint64_t hash = entry.key.hash;
+    this->entries.push_front(move(entry));
+    this->index.emplace(hash, this->entries.begin());
+    this->bytes += size;
+    while(this->bytes > this->budget){ // we drop the entries used longest ago
+        const CacheEntry& last = this->entries.back();
+        auto [from, to] = this->index.equal_range(last.key.hash);
+        for(auto it = from; it != to; it++){
+            if(&*it->second == &last){
+                this->index.erase(it);
+                break;
+            }
+        }
+        this->bytes -= last.key.bytes(last.diagonals.size());
+        this->entries.pop_back();
+    }
+}
+
+bool ResultCache::save(){
+    lock_guard<mutex> guard(this->lock);
+    if(this->path.empty() or this->added.empty()) return true;
+    vector<vector<char>> records;
+    for(uint32_t i = 0; i < this->disk.header.records and this->disk.data; i++){
+        records.emplace_back(this->disk.data + this->disk.offsets[i], this->disk.data + this->disk.offsets[i+1]);
+    }
+    records.insert(records.end(), this->added.begin(), this->added.end());
+    string temp = this->path + ".tmp"; // the old file stays whole until the new one is written
+    if(!writeBinary(temp, BINARY_CACHE, records)) return false;
+    error_code ec;
+    filesystem::rename(temp, this->path, ec); // disk still maps the old file, so added keeps everything that is not in it
+    return !ec;
+}
+
+void BatchStats::add(const BatchStats& other){
+    this->polygons += other.polygons;
+    this->vertices += other.vertices;
+    this->readTime += other.readTime;
+    this->decomposeTime += other.decomposeTime;
+    this->writeTime += other.writeTime;
+    this->cacheHits += other.cacheHits;
+    this->diskHits += other.diskHits;
+    this->savedTime += other.savedTime;
+    this->metrics.add(other.metrics);
+    this->metricsLog += other.metricsLog;
+}
+
+Engine partition(DCEL& polygon, Engine engine){
+    if(engine == Engine::Auto){
+        double n = polygon.vertices.size();
+        if(polygon.algorithm1(0, nullptr, AUTO_BUDGET * n * log2(n))) return Engine::MP1;
+        vector<Vertex> points(polygon.vertices.begin(), polygon.vertices.end()); // we start over on the polygon as it came in
+        polygon.reset();
+        for(const Vertex& v: points) polygon.addVertex(v.x, v.y);
+        polygon.build();
+        engine = Engine::HertelMehlhorn;
+    }
+    if(engine == Engine::HertelMehlhorn) polygon.triangulate();
+    else polygon.algorithm1();
+    return engine;
+}
+
+Engine decompose(DCEL& polygon, Engine engine){
+    polygon.build();
+    engine = partition(polygon, engine);
+    polygon.merging();
+    return engine;
+}
+
+bool PolygonLayout::fits(Coords policy) const{
+    if(policy == Coords::Float) return this->floats;
+    if(policy == Coords::Int32) return this->coords == Coords::Int32;
+    if(policy == Coords::Int64) return this->integers;
+    return true;
+}
+
+PolygonLayout inspect(const vector<Vertex>& P){
+    size_t n = P.size(), low = 0;
+    double most = 0;
+    bool integers = true, floats = true;
+    for(size_t i = 0; i < n; i++){
+        const Vertex& p = P[i];
+        if(p.y < P[low].y or (p.y == P[low].y and p.x < P[low].x)) low = i;
+        most = max(most, max(fabs(p.x), fabs(p.y))); // a NaN is skipped here, and it is not an integer or a float below
+        integers &= p.x == trunc(p.x) and p.y == trunc(p.y);
+        floats &= fabs(p.x) <= FLT_MAX and fabs(p.y) <= FLT_MAX and p.x == (float)p.x and p.y == (float)p.y;
+    }
+    PolygonLayout layout{Winding::CounterClockwise, Coords::Double, floats, integers and most < INT64_LIMIT};
+    if(n >= 3){
+        const Vertex& a = P[low ? low - 1 : n - 1];
+        const Vertex& c = P[low + 1 < n ? low + 1 : 0];
+        if(orient(a.x, a.y, P[low].x, P[low].y, c.x, c.y) < 0) layout.winding = Winding::Clockwise;
+    }
+    if(integers and most < INT32_LIMIT) layout.coords = Coords::Int32;
+    return layout;
+}
+
+template<class F> auto withLayout(DCEL& polygon, Coords policy, Winding winding, Arenas& arenas, F f){
+    auto into = [&](auto& exact){
+        exact.reset();
+        for(const Vertex& v: polygon.vertices) exact.addVertex(v.x, v.y);
+        return f(exact);
+    };
+    bool clockwise = winding == Winding::Clockwise;
+    switch(policy){
+        case Coords::Float: return clockwise ? into(arenas.float32Clockwise) : into(arenas.float32);
+        case Coords::Int32: return clockwise ? into(arenas.int32Clockwise) : into(arenas.int32);
+        case Coords::Int64: return clockwise ? into(arenas.int64Clockwise) : into(arenas.int64);
+        default: return clockwise ? into(arenas.doubleClockwise) : f(polygon);
+    }
+}
+
+bool Worker::run(const Job& job){
+    double st1 = threadSeconds();
+    DCEL& polygon = this->polygon;
+    bool read = job.request ? decodePolygon(job.request->data(), job.request->size(), polygon)
+                : job.source ? loadPolygon(*job.source, job.record, polygon) : readPolygon(job.input, polygon);
+    if(!read){
+        cerr << "Error reading " << (job.source or job.request ? job.name : job.input) << "\n";
+        return false;
+    }
+    bool starts = this->multiStart.starts > 1 and this->engine == Engine::MP1;
+    if(this->cache){ // the settings that change the decomposition go into the key
+        string tag = ENGINE_NAMES[(int)this->engine];
+        if(starts) tag += " starts " + to_string(this->multiStart.starts) + (this->multiStart.prune ? "" : " exhaustive");
+        this->key.make(polygon, tag);
+    }
+
+    // algorithm1 and merging run on the BasicDCEL of the coordinates and the winding of the polygon. The other engines and the
+    // starts only run on DCEL, so for them we negate the x-coordinates of a clockwise polygon instead, which turns it counter-clockwise
+    // exactly and keeps the ids of its vertices
+    PolygonLayout layout = inspect(polygon.vertices);
+    if(this->engine == Engine::MP1 and !starts){
+        return withLayout(polygon, layout.coords, layout.winding, this->arenas, [&](auto& exact){ return this->finish(job, exact, st1, false); });
+    }
+    bool mirrored = layout.winding == Winding::Clockwise;
+    if(mirrored) for(Vertex& v: polygon.vertices) v.x = -v.x;
+    return this->finish(job, polygon, st1, mirrored);
+}
+
+template<class D> bool Worker::finish(const Job& job, D& polygon, double st1, bool mirrored){
+    double st2 = threadSeconds();
+    CacheTier found = CacheTier::None;
+    double seconds = 0;
+    if(this->cache) found = this->cache->find(this->key, polygon, seconds);
+    if(found != CacheTier::None) (found == CacheTier::Memory ? this->stats.cacheHits : this->stats.diskHits)++;
+    else if constexpr(is_same_v<D, DCEL>){
+        if(this->multiStart.starts > 1 and this->engine == Engine::MP1) decomposeMultiStart(polygon, this->startThreads, this->multiStart, this->startArenas);
+        else decompose(polygon, this->engine);
+    }
+    else{
+        polygon.build();
+        polygon.algorithm1();
+        polygon.merging();
+    }
+    double st3 = threadSeconds();
+    if(mirrored) for(auto& v: polygon.vertices) v.x = -v.x;
+    if(found != CacheTier::None) this->stats.savedTime += seconds - (st3 - st2);
+    else if(this->cache) this->cache->insert(this->key, polygon, st3 - st2);
+
+    if(job.result){
+        job.result->clear();
+        encodeDecomposition(polygon, job.name, st3 - st2, *job.result);
+    }
+    else{
+        this->writer.putFaces(polygon);
+        this->writer.put(st3 - st2); // the time we print is the decomposition alone, reading and writing are reported on their own
+        this->writer.put("\n", 1);
+        if(!this->writer.save(job.output)){
+            cerr << "Error writing " << job.output << "\n";
+            return false;
+        }
+    }
+    double st4 = threadSeconds();
+
+    this->stats.polygons++;
+    this->stats.vertices += polygon.vertices.size();
+    this->stats.readTime += st2 - st1;
+    this->stats.decomposeTime += st3 - st2;
+    this->stats.writeTime += st4 - st3;
+    METRIC(this->stats.metrics.add(polygon.metrics));
+    if(this->logMetrics){
+        string name;
+        for(char c: job.name){ // the name is a path, we escape what JSON does not allow in a string
+            if(c == '"' or c == '\\') name += '\\';
+            if((unsigned char)c >= 0x20) name += c;
+        }
+        this->stats.metricsLog += "{\"polygon\": \"" + name + "\", " + polygon.metrics.json() + "}\n";
+    }
+    return true;
+}
+
+bool runBatch(const vector<Job>& jobs, int threads, BatchStats& stats, bool logMetrics, const MultiStart& multiStart, Engine engine, ResultCache* cache){
+    vector<size_t> order(jobs.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b){ return jobs[a].size > jobs[b].size; });
+
+    vector<JobQueue> queues(threads);
+    for(size_t i = 0; i < order.size(); i++){ // we deal the jobs out biggest first, each owner works from the small end of its deque
+        queues[i % threads].jobs.push_front(order[i]);
+    }
+
+    vector<Worker> workers(threads);
+    int spare = max<int>(1, threads / max<size_t>(1, jobs.size())); // the workers past the last job end at once, their threads go to the starts
+    for(Worker& w: workers){
+        w.logMetrics = logMetrics;
+        w.multiStart = multiStart;
+        w.startThreads = spare;
+        w.engine = engine;
+        w.cache = cache;
+    }
+    atomic<bool> ok(true);
+    auto work = [&](int self){
+        size_t job;
+        while(true){
+            bool found = queues[self].pop(job);
+            for(int k = 1; k < threads and !found; k++){ // our deque is empty, so we steal the biggest job left in another one
+                found = queues[(self + k) % threads].steal(job);
+            }
+            if(!found) return; // no job is ever added once the batch started, so every deque is empty now
+            if(!workers[self].run(jobs[job])) ok = false;
+        }
+    };
+    vector<thread> pool;
+    for(int i = 1; i < threads; i++) pool.emplace_back(work, i);
+    work(0);
+    for(thread& t: pool) t.join();
+
+    stats = BatchStats();
+    for(Worker& w: workers) stats.add(w.stats);
+    return ok;
+}
+
+/// @brief Prints how to call the program
+void printUsage(){
+    cerr << "usage: daa                      decompose ./polygons_input/<n>/<n>_<i>.txt into ./decomposed\n"
+            "       daa batch <dir|manifest|file.bin> [-o <output dir|file.bin>] [-t <threads>] [--scaling] [--metrics <file.jsonl>]\n"
+            "                 [--starts <k>] [--starts-budget <seconds>] [--exhaustive] [--engine mp1|hm|auto] [--cache <MiB>] [--cache-file <file>]\n"
+            "           <dir>       every .txt file below it, written to the same relative path in the output dir\n"
+            "           <manifest>  one '<input> [<output>]' per line, the output defaults to <output dir>/<input file name>\n"
+            "           <file.bin>  every polygon of a binary container made by daa pack\n"
+            "           -o          output dir, ./decomposed by default, or a .bin file to write one binary container of decompositions\n"
+            "           -t          number of worker threads, all cores by default\n"
+            "           --scaling   run the batch with 1, 2, 4, ... up to -t threads and report each run\n"
+            "           --metrics   write the counters and phase times of every polygon and of the whole batch as JSON lines,\n"
+            "                       needs a build with -DDAA_METRICS\n"
+            "           --starts    run algorithm1 from k start vertices of every polygon, 1 by default. Runs give up as soon as they are\n"
+            "                       sure to make more diagonals than the best one, and we keep the decomposition with the fewest diagonals,\n"
+            "                       and the fewest pieces among those\n"
+            "           --starts-budget  stop trying new start vertices of a polygon after this many seconds\n"
+            "           --exhaustive     never give up on a run, and keep the decomposition with the fewest pieces of all k runs, which takes longer\n"
+            "           --engine    mp1 (algorithm1 and merging, the default), hm (Hertel-Mehlhorn, a triangulation and merging in O(n log n),\n"
+            "                       more pieces), or auto (mp1 unless it takes more work than n log n allows)\n"
+            "           --cache     reuse the decomposition of a polygon that came before, moved or started from another vertex, keeping\n"
+            "                       the ones used last in this many MiB, 256 by default when only --cache-file is given. With --scaling\n"
+            "                       the runs after the first find their polygons in the cache\n"
+            "           --cache-file     also keep every decomposition in this file, so that later runs find them too\n"
+            "       daa pack <dir|manifest> <file.bin>\n"
+            "           convert text polygon files to one binary container\n"
+            "       daa unpack <file.bin> <output dir> [--polygons <polygons.bin>]\n"
+            "           convert a binary container back to text files, decompositions need the container of their polygons\n"
+            "       daa parallel <polygon file> [-o <output file>] [-t <threads>] [-k <parts>] [--scaling]\n"
+            "           decompose one big polygon by cutting it into parts along diagonals and decomposing the parts concurrently\n"
+            "           -o          output file, ./decomposed.txt by default\n"
+            "           -t          number of threads, all cores by default\n"
+            "           -k          number of parts, as many as threads by default\n"
+            "           --scaling   run the serial decomposition and then 1, 2, 4, ... up to -t threads, and report the speedup\n"
+            "       daa bench [--shapes random,star,comb,spiral,convex] [--sizes 10,100,...] [--warmup <runs>] [--reps <runs>]\n"
+            "                 [--budget <seconds>] [--seed <seed>] [--csv <file>] [--json <file>] [--save <dir>] [--scalar]\n"
+            "                 [--starts 1,4,16,...] [--exhaustive] [--engines mp1,hm,auto] [--edits <k>] [--verify]\n"
+            "                 [--predicates <count>] [--coords double,float,int32,int64] [--grid <units>]\n"
+            "           time the engine and merging on generated polygons, by default every shape with 10 to 10^4 vertices, any size up to 10^6 and more can be given\n"
+            "           --budget    stop repeating a case after this many seconds, it always runs at least once, 10 by default\n"
+            "           --save      also write every generated polygon as a text file to <dir>/<shape>_<n>.txt\n"
+            "           --scalar    run on the scalar kernels even if the CPU has AVX2\n"
+            "           --starts    also decompose every case from each number of start vertices on all cores, and report the pieces and the time\n"
+            "           --exhaustive     never give up on a run of --starts\n"
+            "           --engines   the engines to time on every case, see --engine of daa batch, mp1 by default\n"
+            "           --edits     then move, insert or delete k random vertices one at a time with DCEL::update, and compare the time of\n"
+            "                       an update with decomposing the edited polygon from scratch\n"
+            "           --verify    check the decomposition after every edit of --edits, and count the pieces it has over decomposing from scratch\n"
+            "           --predicates     first time orient against the plain sign of its determinant on count triples of points of each set,\n"
+            "                       random and almost on one line, and count the wrong signs of the plain one\n"
+            "           --coords    the coordinate policies to time mp1 on, double by default. The polygon must fit them, see --grid\n"
+            "           --grid      round every polygon to integers, this many across it, so that it fits int32 or int64. The vertices that\n"
+            "                       round onto their neighbours are dropped, and a polygon whose edges then meet is skipped\n"
+            "       daa serve [--socket <path>] [-t <threads>] [--queue <depth>] [--batch <k>] [--overload block|reject] [--order request|tag]\n"
+            "                 [--engine mp1|hm|auto] [--starts <k>] [--starts-budget <seconds>] [--exhaustive] [--cache <MiB>] [--cache-file <file>]\n"
+            "           decompose the polygons of the requests on stdin until it ends, or of every client of a Unix socket until SIGINT or SIGTERM.\n"
+            "           The frames are described above ServiceFrame in ./src/DAAFinal.cpp\n"
+            "           -t          number of worker threads, all cores by default\n"
+            "           --queue     number of requests that wait for a worker at most, 256 by default\n"
+            "           --batch     number of requests a worker takes from the queue at once at most, 8 by default\n"
+            "           --overload  block stops reading requests while the queue is full, the default, reject answers them with an error\n"
+            "           --order     request writes the replies in the order of the requests, the default, tag as soon as they are done\n"
+            "           --engine, --starts, --starts-budget, --exhaustive, --cache and --cache-file work as for daa batch\n"
+            "       daa load [--socket <path>] [--requests <count>] [--rate <per second>] [--window <k>] [--distinct <k>]\n"
+            "                [--shapes random,...] [--sizes 100,...] [--seed <seed>] [-- <options of daa serve>]\n"
+            "           send generated polygons to daa serve and report the latency and throughput, to the server on the socket or\n"
+            "           to one it starts with the options after --\n"
+            "           --requests  number of polygons to send, 10000 by default\n"
+            "           --rate      send this many per second and count the latency from when each one was due, as fast as --window allows by default\n"
+            "           --window    number of requests that wait for their reply at most, 64 by default\n"
+            "           --distinct  number of different polygons, of each shape and size in turn, sent round robin, 64 by default\n";
+}
+
+bool collectJobs(const filesystem::path& source, const filesystem::path& outputDir, vector<Job>& jobs){
+    error_code ec;
+    if(filesystem::is_directory(source)){
+        size_t first = jobs.size();
+        for(auto& entry: filesystem::recursive_directory_iterator(source)){
+            if(!entry.is_regular_file() or entry.path().extension() != ".txt") continue;
+            filesystem::path name = filesystem::relative(entry.path(), source);
+            jobs.push_back({entry.path().string(), (outputDir / name).string(), name.string(), entry.file_size()});
+        }
+        sort(jobs.begin() + first, jobs.end(), [](const Job& a, const Job& b){ return a.input < b.input; });
+        return true;
+    }
+    ifstream manifest(source);
+    if(!manifest){
+        cerr << "Error opening " << source << "\n";
+        return false;
+    }
+    string line;
+    while(getline(manifest, line)){
+        istringstream fields(line);
+        string input, output;
+        if(!(fields >> input)) continue;
+        string name = filesystem::path(input).filename().string();
+        if(!(fields >> output)) output = (outputDir / name).string();
+        jobs.push_back({input, output, name, filesystem::file_size(input, ec)});
+    }
+    return true;
+}
+
+int batchMain(int argc, char** argv){
+    if(argc < 3){
+        printUsage();
+        return 1;
+    }
+    filesystem::path source = argv[2], outputDir = "./decomposed";
+    int threads = max(1u, thread::hardware_concurrency());
+    bool scaling = false;
+    string metricsPath;
+    MultiStart multiStart;
+    Engine engine = Engine::MP1;
+    double cacheMiB = 0;
+    string cachePath;
+    for(int i = 3; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "-o" and i+1 < argc) outputDir = argv[++i];
+        else if(arg == "--cache" and i+1 < argc) cacheMiB = max(0.0, atof(argv[++i]));
+        else if(arg == "--cache-file" and i+1 < argc) cachePath = argv[++i];
+        else if(arg == "--metrics" and i+1 < argc) metricsPath = argv[++i];
+        else if(arg == "--starts" and i+1 < argc) multiStart.starts = max(1, atoi(argv[++i]));
+        else if(arg == "--starts-budget" and i+1 < argc) multiStart.budget = atof(argv[++i]);
+        else if(arg == "--exhaustive") multiStart.prune = false;
+        else if(arg == "--engine" and i+1 < argc){
+            int k = find(begin(ENGINE_NAMES), end(ENGINE_NAMES), string(argv[++i])) - begin(ENGINE_NAMES);
+            if(k == 3){
+                cerr << "Unknown engine " << argv[i] << "\n";
+                return 1;
+            }
+            engine = (Engine)k;
+        }
+        else if(arg == "-t" and i+1 < argc) threads = max(1, atoi(argv[++i]));
+        else if(arg == "--scaling") scaling = true;
+        else{
+            printUsage();
+            return 1;
+        }
+    }
+
+#ifndef DAA_METRICS
+    if(!metricsPath.empty()){
+        cerr << "--metrics needs a build with -DDAA_METRICS\n";
+        return 1;
+    }
+#endif
+
+    vector<Job> jobs;
+    error_code ec;
+    BinaryFile binary;
+    bool binaryOutput = outputDir.extension() == ".bin";
+    if(!filesystem::is_directory(source) and isBinary(source)){
+        if(!binary.open(source) or binary.header.kind != BINARY_POLYGONS){
+            cerr << "Error opening " << source << ", it is not a binary container of polygons\n";
+            return 1;
+        }
+        for(uint32_t i = 0; i < binary.header.records; i++){
+            string name = binary.name(i);
+            if(name.empty()) name = to_string(i) + ".txt";
+            jobs.push_back({"", (outputDir / name).string(), name, binary.offsets[i+1] - binary.offsets[i], &binary, i});
+        }
+    }
+    else if(!collectJobs(source, outputDir, jobs)) return 1;
+
+    vector<vector<char>> results;
+    if(binaryOutput){ // the workers encode every decomposition into its own slot, and we write them all out in order at the end
+        results.resize(jobs.size());
+        for(size_t i = 0; i < jobs.size(); i++) jobs[i].result = &results[i];
+        if(outputDir.has_parent_path()) filesystem::create_directories(outputDir.parent_path(), ec);
+    }
+    else{
+        for(const Job& job: jobs){ // create the output folders up front, so the workers only open files
+            filesystem::create_directories(filesystem::path(job.output).parent_path(), ec);
+        }
+    }
+
+    ResultCache cache;
+    bool caching = cacheMiB > 0 or !cachePath.empty();
+    if(caching and !cache.open((cacheMiB > 0 ? cacheMiB : 256) * 1024 * 1024, cachePath)){
+        cerr << "Error opening " << cachePath << ", it is not a cache container\n";
+        return 1;
+    }
+
+    vector<int> runs;
+    for(int t = 1; scaling and t < threads; t *= 2) runs.push_back(t);
+    runs.push_back(threads);
+
+    cerr << "threads  polygons  vertices  seconds  polygons/s  vertices/s  read-cpu-s  decompose-cpu-s  write-cpu-s\n";
+    for(int t: runs){
+        BatchStats stats;
+        auto st = chrono::steady_clock::now();
+        bool ok = runBatch(jobs, t, stats, !metricsPath.empty(), multiStart, engine, caching ? &cache : nullptr);
+        if(ok and binaryOutput) ok = writeBinary(outputDir.string(), BINARY_DECOMPOSITIONS, results);
+        if(ok and caching and !cache.save()){
+            cerr << "Error writing " << cachePath << "\n";
+            ok = false;
+        }
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - st).count();
+        cerr << t << "  " << stats.polygons << "  " << stats.vertices << "  " << sec << "  " << stats.polygons / sec << "  " << stats.vertices / sec
+             << "  " << stats.readTime << "  " << stats.decomposeTime << "  " << stats.writeTime << "\n";
+        if(caching){
+            uint64_t hits = stats.cacheHits + stats.diskHits;
+            cerr << "    cache  hits " << hits << "  memory " << stats.cacheHits << "  disk " << stats.diskHits << "  hit-rate "
+                 << (stats.polygons ? (double)hits / stats.polygons : 0) << "  saved-cpu-s " << stats.savedTime << "  entries " << cache.entries.size()
+                 << "  bytes " << cache.bytes << "  on-disk " << cache.disk.header.records * (cache.disk.data != nullptr) + cache.added.size() << "\n";
+        }
+        if(!ok) return 1;
+        if(!metricsPath.empty()){ // one line per polygon, then the whole batch added up, the last run of --scaling wins
+            ofstream metrics(metricsPath);
+            metrics << stats.metricsLog << "{\"batch\": " << t << ", " << stats.metrics.json() << "}\n";
+            if(!metrics){
+                cerr << "Error writing " << metricsPath << "\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int packMain(int argc, char** argv){
+    if(argc != 4){
+        printUsage();
+        return 1;
+    }
+    vector<Job> jobs;
+    if(!collectJobs(argv[2], "", jobs)) return 1;
+    vector<vector<char>> records(jobs.size());
+    DCEL polygon;
+    for(size_t i = 0; i < jobs.size(); i++){
+        if(!readPolygon(jobs[i].input, polygon)){
+            cerr << "Error reading " << jobs[i].input << "\n";
+            return 1;
+        }
+        encodePolygon(polygon, jobs[i].name, records[i]);
+    }
+    if(!writeBinary(argv[3], BINARY_POLYGONS, records)){
+        cerr << "Error writing " << argv[3] << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int unpackMain(int argc, char** argv){
+    if(argc != 4 and !(argc == 6 and string(argv[4]) == "--polygons")){
+        printUsage();
+        return 1;
+    }
+    BinaryFile file, polygons;
+    if(!file.open(argv[2])){
+        cerr << "Error opening " << argv[2] << ", it is not a binary container\n";
+        return 1;
+    }
+    if(file.header.kind == BINARY_DECOMPOSITIONS and (argc != 6 or !polygons.open(argv[5]) or polygons.header.records != file.header.records)){
+        cerr << "Error: a container of decompositions needs the container of its polygons, given with --polygons\n";
+        return 1;
+    }
+    filesystem::path outputDir = argv[3];
+    error_code ec;
+    OutputWriter writer;
+    DCEL polygon;
+    for(uint32_t i = 0; i < file.header.records; i++){
+        string name = file.name(i);
+        if(name.empty()) name = to_string(i) + ".txt";
+        filesystem::path output = outputDir / name;
+        filesystem::create_directories(output.parent_path(), ec);
+        bool ok;
+        if(file.header.kind == BINARY_DECOMPOSITIONS) ok = decodeDecomposition(file, i, polygons, i, writer);
+        else{
+            ok = loadPolygon(file, i, polygon);
+            string count = to_string(polygon.vertices.size()) + "\n";
+            writer.put(count.data(), count.size());
+            for(const Vertex& v: polygon.vertices){ // we print the shortest text that reads back as the same double
+                char text[64];
+                char* p = to_chars(text, text + 64, v.x).ptr;
+                *p++ = ' ';
+                p = to_chars(p, text + 64, v.y).ptr;
+                *p++ = '\n';
+                writer.put(text, p - text);
+            }
+        }
+        if(!ok or !writer.save(output.string())){
+            cerr << "Error converting record " << i << " of " << argv[2] << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
+
+bool isDiagonal(const vector<Vertex>& P, const vector<Id>& poly, size_t a, size_t b){
+    size_t k = poly.size();
+    if(a == b or (a + 1) % k == b or (b + 1) % k == a) return false;
+    auto cross = [&](const Vertex& o, const Vertex& p, const Vertex& q){ return orient(o.x, o.y, p.x, p.y, q.x, q.y); };
+    auto inCone = [&](size_t i, size_t j){ // the segment leaves vertex i strictly inside the polygon
+        const Vertex& v = P[poly[i]];
+        const Vertex& prev = P[poly[(i + k - 1) % k]];
+        const Vertex& next = P[poly[(i + 1) % k]];
+        const Vertex& to = P[poly[j]];
+        if(cross(prev, v, next) > 0) return cross(v, next, to) > 0 and cross(v, to, prev) > 0; // convex vertex
+        return !(cross(v, prev, to) >= 0 and cross(v, to, next) >= 0); // reflex vertex, the segment must not be in the closed outside wedge
+    };
+    if(!inCone(a, b) or !inCone(b, a)) return false;
+
+    const Vertex& p = P[poly[a]];
+    const Vertex& q = P[poly[b]];
+    double x1 = min(p.x, q.x), x2 = max(p.x, q.x), y1 = min(p.y, q.y), y2 = max(p.y, q.y);
+    for(size_t i = 0; i < k; i++){ // no edge that does not end at a or b may touch the segment
+        size_t j = (i + 1) % k;
+        if(i == a or i == b or j == a or j == b) continue;
+        const Vertex& s = P[poly[i]];
+        const Vertex& t = P[poly[j]];
+        if(max(s.x, t.x) < x1 or min(s.x, t.x) > x2 or max(s.y, t.y) < y1 or min(s.y, t.y) > y2) continue;
+        double d1 = cross(p, q, s), d2 = cross(p, q, t), d3 = cross(s, t, p), d4 = cross(s, t, q);
+        if(((d1 > 0 and d2 > 0) or (d1 < 0 and d2 < 0)) or ((d3 > 0 and d4 > 0) or (d3 < 0 and d4 < 0))) continue;
+        return false; // they cross or touch, collinear overlaps included
+    }
+    return true;
+}
+
+size_t visibleFrom(const vector<Vertex>& P, const vector<Id>& poly, size_t a, double rx, double ry){
+    size_t k = poly.size();
+    const Vertex& o = P[poly[a]];
+    auto cross = [](double ux, double uy, double vx, double vy){ return ux * vy - uy * vx; };
+    const Vertex& prev = P[poly[(a + k - 1) % k]];
+    const Vertex& next = P[poly[(a + 1) % k]];
+    bool convex = cross(o.x - prev.x, o.y - prev.y, next.x - o.x, next.y - o.y) > 0;
+    double toNext = cross(next.x - o.x, next.y - o.y, rx, ry), toPrev = cross(rx, ry, prev.x - o.x, prev.y - o.y);
+    if(!(convex ? toNext > 0 and toPrev > 0 : !(toNext <= 0 and toPrev <= 0))) return k; // the ray has to leave a inside the polygon
+
+    double best = numeric_limits<double>::infinity();
+    size_t hit = k;
+    for(size_t i = 0; i < k; i++){ // the closest edge along the ray, the edges at a cannot be hit past a when the ray is in the cone
+        size_t j = (i + 1) % k;
+        if(i == a or j == a) continue;
+        const Vertex& p = P[poly[i]];
+        const Vertex& q = P[poly[j]];
+        double sx = q.x - p.x, sy = q.y - p.y, den = cross(rx, ry, sx, sy);
+        if(den == 0) continue;
+        double t = cross(p.x - o.x, p.y - o.y, sx, sy) / den, u = cross(p.x - o.x, p.y - o.y, rx, ry) / den;
+        if(t > 0 and u >= 0 and u <= 1 and t < best){
+            best = t;
+            hit = i;
+        }
+    }
+    if(hit == k) return k;
+    double hx = o.x + best * rx, hy = o.y + best * ry;
+
+    // of the two ends of the edge we take the one that is further from a along the polygon, for the more balanced cut
+    size_t end = (hit + 1) % k;
+    size_t pick = min((hit + k - a) % k, (a + k - hit) % k) >= min((end + k - a) % k, (a + k - end) % k) ? hit : end;
+    const Vertex& e = P[poly[pick]];
+    double turn = cross(hx - o.x, hy - o.y, e.x - o.x, e.y - o.y);
+    size_t seen = pick;
+    double seenAngle = atan2(fabs(turn), (hx - o.x) * (e.x - o.x) + (hy - o.y) * (e.y - o.y));
+    double seenDist = (e.x - o.x) * (e.x - o.x) + (e.y - o.y) * (e.y - o.y);
+    for(size_t i = 0; i < k; i++){ // a vertex inside the triangle o, hit point, e blocks e, the one closest in angle to the ray is visible
+        if(i == a or i == pick) continue;
+        const Vertex& w = P[poly[i]];
+        double s1 = cross(hx - o.x, hy - o.y, w.x - o.x, w.y - o.y), s2 = cross(e.x - hx, e.y - hy, w.x - hx, w.y - hy), s3 = cross(o.x - e.x, o.y - e.y, w.x - e.x, w.y - e.y);
+        bool inside = turn > 0 ? s1 > 0 and s2 > 0 and s3 >= 0 : s1 < 0 and s2 < 0 and s3 <= 0;
+        if(!inside) continue;
+        double angle = atan2(fabs(s1), (hx - o.x) * (w.x - o.x) + (hy - o.y) * (w.y - o.y));
+        double dist = (w.x - o.x) * (w.x - o.x) + (w.y - o.y) * (w.y - o.y);
+        if(angle < seenAngle or (angle == seenAngle and dist < seenDist)){
+            seen = i;
+            seenAngle = angle;
+            seenDist = dist;
+        }
+    }
+    return seen;
+}
+
+void cutPolygon(const vector<Vertex>& P, int count, vector<vector<Id>>& parts, vector<pair<Id,Id>>& seams){
+    parts.assign(1, vector<Id>(P.size()));
+    iota(parts[0].begin(), parts[0].end(), 0);
+    seams.clear();
+    vector<bool> whole(1, false); // parts we gave up on
+    const size_t SMALLEST = 64; // below this a part is not worth a thread of its own
+    while((int)parts.size() < count){
+        int big = -1;
+        for(size_t i = 0; i < parts.size(); i++){
+            if(!whole[i] and parts[i].size() >= 2 * SMALLEST and (big < 0 or parts[i].size() > parts[big].size())) big = i;
+        }
+        if(big < 0) break;
+        vector<Id>& poly = parts[big];
+        size_t k = poly.size();
+
+        // we look from vertices spread around the part towards the vertex half way round, and keep the most balanced
+        // diagonal we see. We stop early once both sides have a quarter of the part
+        bool found = false;
+        size_t a = 0, b = 0, balance = k / 8;
+        for(int attempt = 0; attempt < 32 and balance < k / 4; attempt++){
+            size_t from = (size_t)(k * fmod(attempt / 2 * 0.6180339887498949, 1.0));
+            const Vertex& o = P[poly[from]];
+            const Vertex& prev = P[poly[(from + k - 1) % k]];
+            const Vertex& next = P[poly[(from + 1) % k]];
+            double rx, ry;
+            if(attempt % 2 == 0){ // towards the vertex half way round
+                rx = P[poly[(from + k / 2) % k]].x - o.x;
+                ry = P[poly[(from + k / 2) % k]].y - o.y;
+            }
+            else{ // along the bisector of the inner angle, the direction that is furthest from the boundary at a
+                double lp = hypot(prev.x - o.x, prev.y - o.y), ln = hypot(next.x - o.x, next.y - o.y);
+                rx = (prev.x - o.x) / lp + (next.x - o.x) / ln;
+                ry = (prev.y - o.y) / lp + (next.y - o.y) / ln;
+                double turn = (o.x - prev.x) * (next.y - o.y) - (o.y - prev.y) * (next.x - o.x);
+                if(rx == 0 and ry == 0){ // a straight angle, the inside is to the left of the edges
+                    rx = -(next.y - o.y);
+                    ry = next.x - o.x;
+                }
+                else if(turn < 0){ // at a reflex vertex the sum of the two edges points outside
+                    rx = -rx;
+                    ry = -ry;
+                }
+            }
+            size_t to = visibleFrom(P, poly, from, rx, ry);
+            if(to == k or !isDiagonal(P, poly, from, to)) continue;
+            size_t side = (to + k - from) % k;
+            side = min(side, k - side);
+            if(side > balance){
+                found = true;
+                balance = side;
+                a = from;
+                b = to;
+            }
+        }
+        if(!found){
+            whole[big] = true;
+            continue;
+        }
+        if(a > b) swap(a, b);
+        seams.push_back({poly[a], poly[b]});
+        vector<Id> other(poly.begin() + b, poly.end()); // the part from b around to a, and poly keeps the part from a to b
+        other.insert(other.end(), poly.begin(), poly.begin() + a + 1);
+        poly.erase(poly.begin() + b + 1, poly.end());
+        poly.erase(poly.begin(), poly.begin() + a);
+        parts.push_back(move(other));
+        whole.push_back(false);
+    }
+}
+
+int decomposeParallel(DCEL& polygon, int count, int threads){
+    vector<vector<Id>> parts;
+    vector<pair<Id,Id>> seams;
+    cutPolygon(polygon.vertices, count, parts, seams);
+
+    if(parts.size() == 1){ // nothing to stitch
+        polygon.build();
+        polygon.algorithm1();
+        polygon.merging();
+        return 1;
+    }
+
+    vector<vector<pair<Id,Id>>> found(parts.size()); // the diagonals of every part that survive its own merging, in polygon's ids
+    atomic<size_t> nextPart(0);
+    auto work = [&](){
+        DCEL piece; // one DCEL per thread, reused for every part it takes
+        size_t i;
+        while((i = nextPart++) < parts.size()){ // the biggest parts come first, so the threads end at about the same time
+            const vector<Id>& ids = parts[i];
+            piece.reset();
+            for(Id v: ids) piece.addVertex(polygon.vertices[v].x, polygon.vertices[v].y);
+            piece.build();
+            piece.algorithm1();
+            piece.merging();
+            const vector<HalfEdge>& he = piece.halfEdges;
+            for(Id d: piece.diags){
+                if(he[he[d].prev].next == d) found[i].push_back({ids[he[d].origin], ids[he[he[d].twin].origin]});
+            }
+        }
+    };
+    sort(parts.begin(), parts.end(), [](const vector<Id>& x, const vector<Id>& y){ return x.size() > y.size(); });
+    vector<thread> pool;
+    for(int t = 1; t < min<int>(threads, parts.size()); t++) pool.emplace_back(work);
+    work();
+    for(thread& t: pool) t.join();
+
+    vector<pair<Id,Id>> diagonals;
+    for(const auto& f: found) diagonals.insert(diagonals.end(), f.begin(), f.end());
+    size_t inner = diagonals.size();
+    diagonals.insert(diagonals.end(), seams.begin(), seams.end());
+    polygon.build();
+    polygon.addDiagonals(diagonals);
+    polygon.merging(inner); // the pieces of a part are already merged, only the seams can still go
+    return parts.size();
+}
+
+int parallelMain(int argc, char** argv){
+    if(argc < 3){
+        printUsage();
+        return 1;
+    }
+    string input = argv[2], output = "./decomposed.txt";
+    int threads = max(1u, thread::hardware_concurrency()), count = 0;
+    bool scaling = false;
+    for(int i = 3; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "-o" and i+1 < argc) output = argv[++i];
+        else if(arg == "-t" and i+1 < argc) threads = max(1, atoi(argv[++i]));
+        else if(arg == "-k" and i+1 < argc) count = max(1, atoi(argv[++i]));
+        else if(arg == "--scaling") scaling = true;
+        else{
+            printUsage();
+            return 1;
+        }
+    }
+
+    DCEL polygon;
+    if(!readPolygon(input, polygon)){
+        cerr << "Error reading " << input << "\n";
+        return 1;
+    }
+    // cutPolygon and algorithm1 need counter-clockwise order, so like Worker::run we negate the x-coordinates of a clockwise polygon,
+    // which keeps the ids of its vertices, and negate them back before writing
+    bool mirrored = inspect(polygon.vertices).winding == Winding::Clockwise;
+    vector<Vertex> points(polygon.vertices.begin(), polygon.vertices.end());
+    if(mirrored) for(Vertex& v: points) v.x = -v.x;
+    auto load = [&](){
+        polygon.reset();
+        for(const Vertex& v: points) polygon.addVertex(v.x, v.y);
+    };
+    auto pieces = [&](){
+        int k = 0;
+        for(Id f = 0; f < polygon.faces.size(); f++) k += polygon.LDP[f];
+        return k;
+    };
+
+    vector<int> runs; // 0 stands for the serial path
+    if(scaling) runs.push_back(0);
+    for(int t = 1; scaling and t < threads; t *= 2) runs.push_back(t);
+    runs.push_back(threads);
+    cerr << "threads  parts  pieces  seconds  speedup\n";
+    double serial = 0;
+    for(int t: runs){
+        load();
+        auto st = chrono::steady_clock::now();
+        int parts = 1;
+        if(t == 0){
+            polygon.build();
+            polygon.algorithm1();
+            polygon.merging();
+        }
+        else parts = decomposeParallel(polygon, count ? count : t, t);
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - st).count();
+        if(t == 0) serial = sec;
+        cerr << (t ? to_string(t) : string("serial")) << "  " << parts << "  " << pieces() << "  " << sec << "  ";
+        if(serial > 0) cerr << serial / sec;
+        else cerr << "-";
+        cerr << "\n";
+    }
+
+    if(mirrored) for(Vertex& v: polygon.vertices) v.x = -v.x;
+    OutputWriter writer;
+    writer.putFaces(polygon);
+    if(!writer.save(output)){
+        cerr << "Error writing " << output << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+void decomposeMultiStart(DCEL& polygon, int threads, MultiStart& multiStart, StartArenas& arenas){
+    double st = steadySeconds();
+    Id n = polygon.vertices.size();
+    int starts = max<int>(1, min<int64_t>(multiStart.starts, n));
+    threads = max(1, min(threads, starts));
+    vector<Vertex> points(polygon.vertices.begin(), polygon.vertices.end());
+
+    // the smallest key wins, the index of the start breaks ties so that the result does not depend on the threads
+    typedef tuple<Id, Id, int> Key;
+    vector<DCEL>& runs = arenas.runs, &kept = arenas.kept; // the run in progress and the best finished run of every thread
+    if(runs.size() < (size_t)threads){
+        runs.resize(threads);
+        kept.resize(threads);
+    }
+    vector<Key> keys(threads, Key(NIL, NIL, INT_MAX));
+    atomic<Id> bound(NIL);
+    atomic<int> nextStart(0), tried(0), pruned(0);
+    auto work = [&](int self){
+        DCEL& run = runs[self];
+        int i;
+        while((i = nextStart++) < starts){
+            if(i > 0 and multiStart.budget > 0 and steadySeconds() - st > multiStart.budget) break;
+            tried++;
+            run.reset();
+            for(const Vertex& v: points) run.addVertex(v.x, v.y);
+            run.build();
+            if(!run.algorithm1((Id)((uint64_t)i * n / starts), multiStart.prune ? &bound : nullptr)){
+                pruned++;
+                continue;
+            }
+            Id d = run.diags.size(), b = bound.load();
+            while(d < b and !bound.compare_exchange_weak(b, d)); // we lower the bound the other runs see
+            run.merging();
+            Id pieces = 0;
+            for(Id f = 0; f < run.faces.size(); f++) pieces += run.LDP[f];
+            Key key = multiStart.prune ? Key(d, pieces, i) : Key(pieces, d, i);
+            if(key < keys[self]){
+                keys[self] = key;
+                swap(run, kept[self]);
+            }
+        }
+    };
+    vector<thread> pool;
+    for(int t = 1; t < threads; t++) pool.emplace_back(work, t);
+    work(0);
+    for(thread& t: pool) t.join();
+
+    int best = min_element(keys.begin(), keys.end()) - keys.begin(); // a run only gives up once another one finished, so there is one
+    swap(polygon, kept[best]); // no storage is freed or made, the one of polygon is reused by the next call
+    multiStart.tried = tried;
+    multiStart.pruned = pruned;
+    multiStart.start = (Id)((uint64_t)get<2>(keys[best]) * n / starts);
+    multiStart.diagonals = polygon.diags.size();
+    multiStart.pieces = 0;
+    for(Id f = 0; f < polygon.faces.size(); f++) multiStart.pieces += polygon.LDP[f];
+    multiStart.seconds = steadySeconds() - st;
+}
+
+void generatePolygon(Shape shape, int n, uint64_t seed, vector<Vertex>& polygon){
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    const double PI = acos(-1.0);
+    polygon.clear();
+    polygon.reserve(n);
+    auto add = [&](double x, double y){ polygon.push_back(Vertex(x, y)); };
+
+    if(shape == Shape::Random){
+        vector<pair<double,double>> pts(n);
+        for(auto& p: pts) p = {unit(rng) * 1000, unit(rng) * 1000};
+        sort(pts.begin(), pts.end());
+        auto [x0, y0] = pts.front();
+        auto [x1, y1] = pts.back();
+        vector<pair<double,double>> upper;
+        add(x0, y0);
+        for(int i = 1; i < n-1; i++){ // the lower chain goes left to right, the upper one comes back right to left
+            bool above = (x1 - x0) * (pts[i].second - y0) - (y1 - y0) * (pts[i].first - x0) > 0;
+            if(above) upper.push_back(pts[i]);
+            else add(pts[i].first, pts[i].second);
+        }
+        add(x1, y1);
+        for(auto it = upper.rbegin(); it != upper.rend(); it++) add(it->first, it->second);
+    }
+    else if(shape == Shape::Star or shape == Shape::NearlyConvex){
+        vector<double> angles(n);
+        for(double& a: angles) a = unit(rng) * 2 * PI;
+        sort(angles.begin(), angles.end());
+        for(double a: angles){ // the vertices go around the origin in order of angle, so the polygon is simple whatever the radii are
+            double r = shape == Shape::Star ? 20 + 80 * unit(rng) : (unit(rng) < 0.01 ? 99.9 : 100);
+            add(cos(a) * r, sin(a) * r);
+        }
+    }
+    else if(shape == Shape::Comb){
+        int teeth = max(1, (n - 2) / 3), extra = n - 2 - 3 * teeth;
+        double w = 10;
+        add(0, 0);
+        for(int i = 1; i <= extra; i++) add(teeth * w * i / (extra + 1), -unit(rng)); // we pad the base up to n vertices
+        add(teeth * w, 0);
+        for(int t = teeth - 1; t >= 0; t--){
+            double x = t * w;
+            add(x + w, 5 + (unit(rng) * 4 - 2));
+            add(x + w * 0.7, 15 + unit(rng) * 30);
+            add(x + w * 0.3, 15 + unit(rng) * 30);
+        }
+    }
+    else{
+        // outer side at radius 1 + turns * angle / 2pi, inner side half a unit below it. We take few enough turns that the chords of
+        // both sides stay well inside the band, chord sag is about r * step^2 / 8
+        int half = n / 2;
+        double turns = max(0.5, cbrt((double)n * n / (8 * PI * PI)) / 2);
+        double total = 2 * PI * turns;
+        for(int i = 0; i < n - half; i++){
+            double a = total * i / (n - half - 1), r = 1 + a / (2 * PI);
+            add(cos(a) * r, sin(a) * r);
+        }
+        for(int i = half - 1; i >= 0; i--){
+            double a = total * i / max(1, half - 1), r = 0.5 + a / (2 * PI);
+            add(cos(a) * r, sin(a) * r);
+        }
+    }
+}
+
+void dropDegenerate(vector<Vertex>& polygon){
+    size_t n = polygon.size(), left = n;
+    if(n < 3) return;
+    vector<size_t> prev(n), next(n), todo(n);
+    vector<bool> gone(n, false);
+    for(size_t i = 0; i < n; i++){
+        prev[i] = i ? i - 1 : n - 1;
+        next[i] = i + 1 < n ? i + 1 : 0;
+        todo[i] = i;
+    }
+    while(!todo.empty() and left >= 3){
+        size_t i = todo.back();
+        todo.pop_back();
+        if(gone[i]) continue;
+        const Vertex& a = polygon[prev[i]];
+        const Vertex& b = polygon[i];
+        const Vertex& c = polygon[next[i]];
+        if(orient(a.x, a.y, b.x, b.y, c.x, c.y) != 0) continue;
+        gone[i] = true;
+        left--;
+        next[prev[i]] = next[i];
+        prev[next[i]] = prev[i];
+        todo.push_back(prev[i]);
+        todo.push_back(next[i]);
+    }
+    size_t k = 0;
+    for(size_t i = 0; i < n; i++) if(!gone[i]) polygon[k++] = polygon[i];
+    polygon.erase(polygon.begin() + k, polygon.end());
+}
+
+bool isSimple(const vector<Vertex>& polygon){
+    size_t n = polygon.size();
+    if(n < 3) return false;
+    auto before = [&](size_t a, size_t b){ // a comes first from left to right, and from bottom to top on a vertical line
+        return polygon[a].x < polygon[b].x or (polygon[a].x == polygon[b].x and polygon[a].y < polygon[b].y);
+    };
+    auto left = [&](size_t e){ size_t f = e + 1 < n ? e + 1 : 0; return before(e, f) ? e : f; }; // edge e goes from vertex e to e+1
+    auto right = [&](size_t e){ size_t f = e + 1 < n ? e + 1 : 0; return before(e, f) ? f : e; };
+    auto side = [&](size_t e, size_t v){
+        const Vertex& a = polygon[left(e)];
+        const Vertex& b = polygon[right(e)];
+        return orient(a.x, a.y, b.x, b.y, polygon[v].x, polygon[v].y);
+    };
+    auto below = [&](size_t a, size_t b){ // a is below b where the sweep line crosses both, edges that share their left end are ordered by their right end
+        if(a == b) return false;
+        if(!before(left(b), left(a))){
+            double d = side(a, left(b));
+            return (d != 0 ? d : side(a, right(b))) > 0;
+        }
+        double d = side(b, left(a));
+        return (d != 0 ? d : side(b, right(a))) < 0;
+    };
+    auto meet = [&](size_t a, size_t b){ // consecutive edges only share their vertex, there is no collinear run
+        if(b == (a + 1) % n or a == (b + 1) % n) return false;
+        return segmentsMeet(polygon[a], polygon[(a + 1) % n], polygon[b], polygon[(b + 1) % n]);
+    };
+
+    // the edges the sweep line crosses, ordered from bottom to top. Two edges can only meet after they were next to each other in
+    // it, so we test every edge against its neighbours when it comes in, and its neighbours against each other when it leaves
+    set<size_t, decltype(below)> crossed(below);
+    vector<set<size_t, decltype(below)>::iterator> at(n);
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(), before);
+    for(size_t i = 1; i < n; i++) if(!before(order[i-1], order[i])) return false; // two vertices on one point, the sweep only meets one of them
+    for(size_t v: order){
+        size_t ends[] = {v ? v - 1 : n - 1, v};
+        for(size_t e: ends){
+            if(right(e) != v) continue;
+            auto it = crossed.erase(at[e]);
+            if(it != crossed.begin() and it != crossed.end() and meet(*prev(it), *it)) return false;
+        }
+        for(size_t e: ends){
+            if(left(e) != v) continue;
+            auto it = at[e] = crossed.insert(e).first;
+            if(it != crossed.begin() and meet(*prev(it), e)) return false;
+            if(next(it) != crossed.end() and meet(e, *next(it))) return false;
+        }
+    }
+    return true;
+}
+
+double percentile(const vector<double>& sorted, double p){
+    size_t rank = (size_t)ceil(p / 100 * sorted.size());
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+string checkDecomposition(const DCEL& polygon){
+    const vector<HalfEdge>& he = polygon.halfEdges;
+    const vector<Vertex>& P = polygon.vertices;
+    auto after = [&](Id v){ return he[he[polygon.boundary[v]].twin].origin; };
+    auto cross = [&](Id a, Id b){ return P[a].x * P[b].y - P[b].x * P[a].y; }; // twice the area a, b add to the polygon they are an edge of
+    Id first = NIL;
+    size_t live = 0;
+    for(Id v = 0; v < P.size(); v++) if(polygon.boundary[v] != NIL){
+        if(first == NIL) first = v;
+        live++;
+    }
+    if(live < 3) return "fewer than 3 vertices";
+
+    vector<uint8_t> seen(he.size(), 0); // how many pieces each half-edge is in
+    size_t pieces = 0;
+    double area = 0, scale = 0;
+    for(Id f = 0; f < polygon.faces.size(); f++){
+        if(!polygon.LDP[f]) continue;
+        pieces++;
+        Id start = polygon.faces[f].outerComponent, e = start;
+        size_t k = 0;
+        do{
+            Id n = he[e].next;
+            if(n == NIL or he[n].prev != e) return "piece " + to_string(f) + ": next and prev of half-edge " + to_string(e) + " disagree";
+            if(he[n].origin != he[he[e].twin].origin) return "piece " + to_string(f) + ": half-edge " + to_string(e) + " does not end where the next one starts";
+            if(!DCEL::signedArea(P[he[e].origin], P[he[n].origin], P[he[he[n].next].origin])) return "piece " + to_string(f) + " is not convex at vertex " + to_string(he[n].origin);
+            if(seen[e]++) return "half-edge " + to_string(e) + " is in more than one piece";
+            area += cross(he[e].origin, he[n].origin);
+            scale += fabs(cross(he[e].origin, he[n].origin));
+            e = n;
+            if(++k > he.size()) return "piece " + to_string(f) + " does not close";
+        } while(e != start);
+    }
+
+    double whole = 0;
+    size_t r = 0, k = 0;
+    Id v = first;
+    do{
+        Id w = after(v);
+        if(seen[polygon.boundary[v]] != 1) return "edge " + to_string(v) + " - " + to_string(w) + " of the polygon is in " + to_string(seen[polygon.boundary[v]]) + " pieces";
+        r += !DCEL::signedArea(P[v], P[w], P[after(w)]);
+        whole += cross(v, w);
+        v = w;
+        if(++k > live) return "the boundary of the polygon does not close";
+    } while(v != first);
+    if(k != live) return "the boundary of the polygon passes " + to_string(k) + " of its " + to_string(live) + " vertices";
+    if(fabs(area - whole) > 1e-9 * scale) return "the pieces have area " + to_string(area / 2) + ", the polygon " + to_string(whole / 2);
+    if(pieces > 2 * r + 1) return to_string(pieces) + " pieces for " + to_string(r) + " notches";
+    return "";
+}
+
+void benchEdits(DCEL& polygon, Engine engine, int count, uint64_t seed, bool verify, BenchCase& result){
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    const vector<HalfEdge>& he = polygon.halfEdges;
+    auto after = [&](Id v){ return he[he[polygon.boundary[v]].twin].origin; };
+    auto before = [&](Id v){ return he[he[he[he[polygon.boundary[v]].twin].next].twin].origin; };
+    auto notch = [&](Id v){ return !DCEL::signedArea(polygon.vertices[before(v)], polygon.vertices[v], polygon.vertices[after(v)]); };
+    auto pieces = [](const DCEL& d){
+        int k = 0;
+        for(Id f = 0; f < d.faces.size(); f++) k += d.LDP[f];
+        return k;
+    };
+    vector<Id> live;
+    for(Id v = 0; v < polygon.vertices.size(); v++) if(polygon.boundary[v] != NIL) live.push_back(v);
+    DCEL fresh; // the edited polygon decomposed from scratch, reused by every check of verify
+    auto copy = [&](){
+        fresh.reset();
+        Id v = live[0];
+        do{
+            fresh.addVertex(polygon.vertices[v].x, polygon.vertices[v].y);
+            v = after(v);
+        } while(v != live[0]);
+    };
+
+    for(int k = 0; k < count; k++){
+        size_t at = rng() % live.size();
+        Id v = live[at], w = after(v), u = before(v);
+        Edit edit{(EditKind)(rng() % 3), v, 0, 0};
+        const Vertex& pu = polygon.vertices[u];
+        const Vertex& pv = polygon.vertices[v];
+        const Vertex& pw = polygon.vertices[w];
+        if(edit.kind == EditKind::Move){
+            double t = unit(rng) * 1.5;
+            edit.x = pv.x + t * ((pu.x + pw.x) / 2 - pv.x);
+            edit.y = pv.y + t * ((pu.y + pw.y) / 2 - pv.y);
+        }
+        else if(edit.kind == EditKind::Insert){
+            double off = (unit(rng) - 0.5) * 0.2;
+            edit.x = (pv.x + pw.x) / 2 - (pw.y - pv.y) * off;
+            edit.y = (pv.y + pw.y) / 2 + (pw.x - pv.x) * off;
+        }
+        else if(live.size() <= 3) continue;
+
+        // the edges the edit makes, NIL standing for the new position, must not meet an edge of the polygon that they do not share an end
+        // with. A move past the middle of the neighbours can also turn a small polygon inside out without any edges crossing, so the
+        // area, twice the sum of cross over the edges, must stay positive
+        Vertex to(edit.x, edit.y);
+        auto point = [&](Id p) -> const Vertex& { return p == NIL ? to : polygon.vertices[p]; };
+        auto cross = [&](Id p, Id q){ return point(p).x * point(q).y - point(q).x * point(p).y; };
+        vector<pair<Id,Id>> made, replaced;
+        if(edit.kind == EditKind::Move) made = {{u, NIL}, {NIL, w}}, replaced = {{u, v}, {v, w}};
+        else if(edit.kind == EditKind::Insert) made = {{v, NIL}, {NIL, w}}, replaced = {{v, w}};
+        else made = {{u, w}}, replaced = {{u, v}, {v, w}};
+        bool simple = true;
+        double area = 0;
+        Id a = v;
+        do{
+            Id b = after(a);
+            area += cross(a, b);
+            for(auto [p, q]: made){
+                bool gone = edit.kind == EditKind::Insert ? a == v : a == v or b == v;
+                if(gone or a == p or a == q or b == p or b == q) continue;
+                if(segmentsMeet(point(p), point(q), polygon.vertices[a], polygon.vertices[b])) simple = false;
+            }
+            a = b;
+        } while(a != v and simple);
+        for(auto [p, q]: made) area += cross(p, q);
+        for(auto [p, q]: replaced) area -= cross(p, q);
+        if(!simple or !(area > 0)) continue;
+
+        Id ends[] = {u, v, w};
+        bool was[3];
+        for(int i = 0; i < 3; i++) was[i] = notch(ends[i]);
+        double st = steadySeconds();
+        if(polygon.update({edit}) == 0) continue;
+        result.updates.push_back(steadySeconds() - st);
+        if(edit.kind == EditKind::Insert) live.push_back(polygon.vertices.size() - 1);
+        else if(edit.kind == EditKind::Delete){
+            live[at] = live.back();
+            live.pop_back();
+        }
+        bool flip = false;
+        for(int i = 0; i < 3; i++) flip |= polygon.boundary[ends[i]] != NIL and notch(ends[i]) != was[i];
+        result.flips += flip;
+
+        if(!verify) continue;
+        string wrong = checkDecomposition(polygon);
+        if(!wrong.empty()){
+            if(result.failures++ == 0) cerr << "    edit " << k << " of vertex " << v << ": " << wrong << "\n";
+        }
+        copy();
+        fresh.build();
+        fresh.algorithm1();
+        fresh.merging();
+        result.extraPieces = max(result.extraPieces, pieces(polygon) - pieces(fresh));
+    }
+    result.editPieces = pieces(polygon);
+
+    copy();
+    double st = steadySeconds();
+    decompose(fresh, engine);
+    result.recompute = steadySeconds() - st;
+    result.recomputePieces = pieces(fresh);
+}
+
+void benchPredicates(int count, uint64_t seed){
+    mt19937_64 rng(seed);
+    uniform_real_distribution<double> coord(0.0, 1000.0), along(-1.0, 2.0);
+    cerr << "set  triples  plain-s  orient-s  exact-calls  plain-wrong\n";
+    const char* names[] = {"random", "collinear", "collinear-far"};
+    for(int set = 0; set < 3; set++){
+        vector<double> t(6 * (size_t)count); // ax, ay, bx, by, cx, cy of every triple
+        double off = set == 2 ? 1e9 : 0;
+        for(int i = 0; i < count; i++){
+            double* q = &t[6 * (size_t)i];
+            for(int k = 0; k < 4; k++) q[k] = coord(rng) + off;
+            if(set == 0){
+                q[4] = coord(rng) + off;
+                q[5] = coord(rng) + off;
+            }
+            else{
+                double s = along(rng);
+                q[4] = q[0] + s * (q[2] - q[0]);
+                q[5] = q[1] + s * (q[3] - q[1]);
+            }
+        }
+        auto plain = [](const double* q){ return (q[2] - q[0])*(q[5] - q[1]) - (q[3] - q[1])*(q[4] - q[0]); };
+        auto sign = [](double d){ return (d > 0) - (d < 0); };
+        long sum = 0;
+        double st = steadySeconds();
+        for(int i = 0; i < count; i++) sum += plain(&t[6 * (size_t)i]) > 0;
+        double plainTime = steadySeconds() - st;
+        st = steadySeconds();
+        for(int i = 0; i < count; i++){
+            const double* q = &t[6 * (size_t)i];
+            sum += orient(q[0], q[1], q[2], q[3], q[4], q[5]) > 0;
+        }
+        double orientTime = steadySeconds() - st;
+        long exact = 0, wrong = 0;
+        for(int i = 0; i < count; i++){ // outside of the timings
+            const double* q = &t[6 * (size_t)i];
+            double l = (q[2] - q[0])*(q[5] - q[1]), r = (q[3] - q[1])*(q[4] - q[0]);
+            exact += !(fabs(l - r) > ORIENT_BOUND * (fabs(l) + fabs(r)));
+            wrong += sign(plain(q)) != sign(orient(q[0], q[1], q[2], q[3], q[4], q[5]));
+        }
+        cerr << names[set] << "  " << count << "  " << plainTime << "  " << orientTime << "  " << exact << "  " << wrong
+             << (sum == LONG_MIN ? " " : "") << "\n"; // we use sum so that the loops are not optimized away
+    }
+}
+
+int benchMain(int argc, char** argv){
+    vector<Shape> shapes = {Shape::Random, Shape::Star, Shape::Comb, Shape::Spiral, Shape::NearlyConvex};
+    vector<int> sizes = {10, 100, 1000, 10000};
+    int warmup = 1, reps = 10;
+    double budget = 10;
+    uint64_t seed = 1;
+    string csvPath, jsonPath, saveDir;
+    vector<int> starts;
+    bool prune = true;
+    vector<Engine> engines = {Engine::MP1};
+    int edits = 0;
+    bool verify = false;
+    int predicates = 0;
+    vector<Coords> coords = {Coords::Double};
+    double grid = 0;
+    auto list = [](const string& arg){
+        vector<string> items;
+        string item;
+        istringstream in(arg);
+        while(getline(in, item, ',')) if(!item.empty()) items.push_back(item);
+        return items;
+    };
+    for(int i = 2; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--scalar"){ // to compare against the SIMD kernels on the same build
+            kernels = pickKernels(false);
+            int32Kernels = pickInt32Kernels(false);
+            continue;
+        }
+        if(arg == "--exhaustive"){
+            prune = false;
+            continue;
+        }
+        if(arg == "--verify"){
+            verify = true;
+            continue;
+        }
+        if(i+1 >= argc){
+            printUsage();
+            return 1;
+        }
+        string value = argv[++i];
+        if(arg == "--shapes"){
+            shapes.clear();
+            for(const string& name: list(value)){
+                int k = find(begin(SHAPE_NAMES), end(SHAPE_NAMES), name) - begin(SHAPE_NAMES);
+                if(k == 5){
+                    cerr << "Unknown shape " << name << "\n";
+                    return 1;
+                }
+                shapes.push_back((Shape)k);
+            }
+        }
+        else if(arg == "--sizes"){
+            sizes.clear();
+            for(const string& size: list(value)) sizes.push_back(max(4, (int)stod(size)));
+        }
+        else if(arg == "--warmup") warmup = max(0, atoi(value.c_str()));
+        else if(arg == "--reps") reps = max(1, atoi(value.c_str()));
+        else if(arg == "--budget") budget = atof(value.c_str());
+        else if(arg == "--seed") seed = strtoull(value.c_str(), nullptr, 10);
+        else if(arg == "--csv") csvPath = value;
+        else if(arg == "--json") jsonPath = value;
+        else if(arg == "--save") saveDir = value;
+        else if(arg == "--edits") edits = max(0, atoi(value.c_str()));
+        else if(arg == "--predicates") predicates = max(0, atoi(value.c_str()));
+        else if(arg == "--grid") grid = max(0.0, atof(value.c_str()));
+        else if(arg == "--coords"){
+            coords.clear();
+            for(const string& name: list(value)){
+                int k = find(begin(COORDS_NAMES), end(COORDS_NAMES), name) - begin(COORDS_NAMES);
+                if(k == 4){
+                    cerr << "Unknown coordinates " << name << "\n";
+                    return 1;
+                }
+                coords.push_back((Coords)k);
+            }
+        }
+        else if(arg == "--starts") for(const string& k: list(value)) starts.push_back(max(1, atoi(k.c_str())));
+        else if(arg == "--engines"){
+            engines.clear();
+            for(const string& name: list(value)){
+                int k = find(begin(ENGINE_NAMES), end(ENGINE_NAMES), name) - begin(ENGINE_NAMES);
+                if(k == 3){
+                    cerr << "Unknown engine " << name << "\n";
+                    return 1;
+                }
+                engines.push_back((Engine)k);
+            }
+        }
+        else{
+            printUsage();
+            return 1;
+        }
+    }
+
+    if(predicates) benchPredicates(predicates, seed);
+
+    vector<BenchCase> cases;
+    vector<Vertex> points;
+    DCEL polygon; // one DCEL for all the cases, like a batch worker, so the arenas are only grown once
+    Arenas arenas;
+    StartArenas startArenas;
+    error_code ec;
+    if(!saveDir.empty()) filesystem::create_directories(saveDir, ec);
+    cerr << "shape  engine  n  notches  pieces  reps  partition-p50-s  merging-p50-s\n";
+    for(Shape shape: shapes){
+        for(int n: sizes){
+            generatePolygon(shape, n, seed * 1000003 + n * 31 + (int)shape, points);
+            if(grid > 0){ // we round the polygon to integers, grid of them across its bounding box
+                double lo = INFINITY, hi = -INFINITY;
+                for(const Vertex& v: points) lo = min({lo, v.x, v.y}), hi = max({hi, v.x, v.y});
+                for(Vertex& v: points) v = Vertex(round((v.x - lo) / (hi - lo) * grid), round((v.y - lo) / (hi - lo) * grid));
+                dropDegenerate(points); // vertices that round to the same point or onto one line
+                if(!isSimple(points)){ // the engines expect a simple polygon, and edges can cross once they are rounded
+                    cerr << SHAPE_NAMES[(int)shape] << "  " << n << ": rounded to a grid of " << grid << " the polygon is no longer simple, try a finer --grid\n";
+                    continue;
+                }
+            }
+            PolygonLayout layout = inspect(points);
+            if(!saveDir.empty()){
+                OutputWriter writer;
+                string head = to_string(points.size()) + "\n";
+                writer.put(head.data(), head.size());
+                for(const Vertex& v: points){
+                    char text[64];
+                    char* p = to_chars(text, text + 64, v.x).ptr;
+                    *p++ = ' ';
+                    p = to_chars(p, text + 64, v.y).ptr;
+                    *p++ = '\n';
+                    writer.put(text, p - text);
+                }
+                writer.save(saveDir + "/" + SHAPE_NAMES[(int)shape] + "_" + to_string(n) + ".txt");
+            }
+
+            for(Engine engine: engines) for(Coords policy: engine == Engine::MP1 ? coords : vector<Coords>{Coords::Double}){
+                if(!layout.fits(policy)){
+                    cerr << SHAPE_NAMES[(int)shape] << "  " << n << ": the coordinates are not " << COORDS_NAMES[(int)policy] << ", see --grid\n";
+                    continue;
+                }
+                BenchCase result;
+                result.shape = shape;
+                result.engine = engine;
+                result.coords = policy;
+                result.used = engine; // the requested engine until partition reports the one that ran
+                result.n = points.size();
+                auto repeat = [&](auto& exact){ // the other engines only run on DCEL
+                    double spent = 0;
+                    for(int run = 0; run < warmup + reps; run++){
+                        exact.reset();
+                        for(const Vertex& v: points) exact.addVertex(v.x, v.y);
+                        exact.build();
+                        if(run == 0) for(Id v = 0; v < exact.vertices.size(); v++) result.notches += exact.isNotch(v);
+                        auto t0 = chrono::steady_clock::now();
+                        if constexpr(is_same_v<decay_t<decltype(exact)>, DCEL>) result.used = partition(exact, engine);
+                        else exact.algorithm1();
+                        auto t1 = chrono::steady_clock::now();
+                        exact.merging();
+                        auto t2 = chrono::steady_clock::now();
+                        double a = chrono::duration<double>(t1 - t0).count(), m = chrono::duration<double>(t2 - t1).count();
+                        spent += a + m;
+                        bool last = spent > budget;
+                        if(run >= warmup or last){ // a warmup that is already over the budget is kept instead of running the case again
+                            result.partition.push_back(a);
+                            result.merging.push_back(m);
+                        }
+                        if(last) break;
+                    }
+                    for(Id f = 0; f < exact.faces.size(); f++) result.pieces += exact.LDP[f];
+                    result.metrics = exact.metrics;
+                    return true;
+                };
+                polygon.reset(); // repeat adds the vertices itself on every run
+                withLayout(polygon, policy, layout.winding, arenas, repeat);
+
+                vector<double> a = result.partition, m = result.merging;
+                sort(a.begin(), a.end());
+                sort(m.begin(), m.end());
+                cerr << SHAPE_NAMES[(int)shape] << "  " << ENGINE_NAMES[(int)engine] << (engine == Engine::Auto ? string(">") + ENGINE_NAMES[(int)result.used] : "")
+                     << (policy != Coords::Double ? string(":") + COORDS_NAMES[(int)policy] : "") << "  " << result.n << "  " << result.notches << "  "
+                     << result.pieces << "  " << a.size() << "  " << percentile(a, 50) << "  " << percentile(m, 50) << "\n";
+                bool onDCEL = policy == Coords::Double and layout.winding == Winding::CounterClockwise; // the edits and the starts only run on DCEL
+                if(edits > 0 and onDCEL){ // the polygon still holds the decomposition of the last repetition
+                    benchEdits(polygon, engine, edits, seed * 1000003 + n * 31 + (int)shape, verify, result);
+                    vector<double> u = result.updates;
+                    sort(u.begin(), u.end());
+                    cerr << "    edits " << u.size() << "  pieces " << result.editPieces << "  update-p50-s " << (u.empty() ? 0 : percentile(u, 50))
+                         << "  update-p99-s " << (u.empty() ? 0 : percentile(u, 99)) << "  recompute-s " << result.recompute
+                         << "  recompute-pieces " << result.recomputePieces << "  flips " << result.flips;
+                    if(verify) cerr << "  failures " << result.failures << "  extra-pieces " << result.extraPieces;
+                    cerr << "\n";
+                }
+                for(int k = 0; engine == Engine::MP1 and onDCEL and k < (int)starts.size(); k++){ // more starts only make sense for mp1
+                    MultiStart multiStart;
+                    multiStart.starts = starts[k];
+                    multiStart.prune = prune;
+                    polygon.reset();
+                    for(const Vertex& v: points) polygon.addVertex(v.x, v.y);
+                    decomposeMultiStart(polygon, max(1u, thread::hardware_concurrency()), multiStart, startArenas);
+                    result.multiStarts.push_back(multiStart);
+                    cerr << "    starts " << starts[k] << "  tried " << multiStart.tried << "  pruned " << multiStart.pruned << "  pieces " << multiStart.pieces
+                         << "  seconds " << multiStart.seconds << "\n";
+                }
+                cases.push_back(result);
+            }
+        }
+    }
+
+    const double PERCENTILES[] = {0, 50, 90, 99, 100};
+    const char* const PERCENTILE_NAMES[] = {"min", "p50", "p90", "p99", "max"};
+    if(!csvPath.empty()){
+        ofstream csv(csvPath);
+        csv << "shape,engine,n,notches,pieces,phase,reps,mean";
+        for(const char* name: PERCENTILE_NAMES) csv << "," << name;
+        csv << "\n" << setprecision(9);
+        for(const BenchCase& c: cases){
+            const char* first = c.used == Engine::HertelMehlhorn ? "triangulate" : "algorithm1";
+            for(int phase = 0; phase < 2; phase++){
+                vector<double> t = phase ? c.merging : c.partition;
+                sort(t.begin(), t.end());
+                csv << SHAPE_NAMES[(int)c.shape] << "," << ENGINE_NAMES[(int)c.engine] << (c.coords != Coords::Double ? string(":") + COORDS_NAMES[(int)c.coords] : "")
+                    << "," << c.n << "," << c.notches << "," << c.pieces << "," << (phase ? "merging" : first)
+                    << "," << t.size() << "," << accumulate(t.begin(), t.end(), 0.0) / t.size();
+                for(double p: PERCENTILES) csv << "," << percentile(t, p);
+                csv << "\n";
+            }
+            if(!c.updates.empty()){
+                vector<double> t = c.updates;
+                sort(t.begin(), t.end());
+                csv << SHAPE_NAMES[(int)c.shape] << "," << ENGINE_NAMES[(int)c.engine] << "," << c.n << "," << c.notches << "," << c.editPieces
+                    << ",update," << t.size() << "," << accumulate(t.begin(), t.end(), 0.0) / t.size();
+                for(double p: PERCENTILES) csv << "," << percentile(t, p);
+                csv << "\n" << SHAPE_NAMES[(int)c.shape] << "," << ENGINE_NAMES[(int)c.engine] << "," << c.n << "," << c.notches << "," << c.recomputePieces
+                    << ",recompute,1," << c.recompute;
+                for(size_t k = 0; k < size(PERCENTILES); k++) csv << "," << c.recompute;
+                csv << "\n";
+            }
+            for(const MultiStart& r: c.multiStarts){ // one timed run each, its time stands in for every statistic
+                csv << SHAPE_NAMES[(int)c.shape] << "," << ENGINE_NAMES[(int)c.engine] << "," << c.n << "," << c.notches << "," << r.pieces
+                    << ",starts" << r.starts << ",1," << r.seconds;
+                for(size_t k = 0; k < size(PERCENTILES); k++) csv << "," << r.seconds;
+                csv << "\n";
+            }
+        }
+        if(!csv){
+            cerr << "Error writing " << csvPath << "\n";
+            return 1;
+        }
+    }
+    if(!jsonPath.empty()){
+        ofstream json(jsonPath);
+        json << setprecision(9) << "{\n  \"compiler\": \"" << __VERSION__ << "\",\n  \"simd\": " << (kernels.rectHits != rectHitsScalar<DoubleCoords> ? "true" : "false")
+             << ",\n  \"seed\": " << seed << ",\n  \"warmup\": " << warmup
+             << ",\n  \"reps\": " << reps << ",\n  \"budget\": " << budget << ",\n  \"cases\": [";
+        for(size_t i = 0; i < cases.size(); i++){
+            const BenchCase& c = cases[i];
+            json << (i ? ",\n" : "\n") << "    {\"shape\": \"" << SHAPE_NAMES[(int)c.shape] << "\", \"engine\": \"" << ENGINE_NAMES[(int)c.engine]
+                 << "\", \"coords\": \"" << COORDS_NAMES[(int)c.coords] << "\", \"used\": \"" << ENGINE_NAMES[(int)c.used] << "\", \"n\": " << c.n << ", \"notches\": " << c.notches << ", \"pieces\": " << c.pieces;
+            for(int phase = 0; phase < 2; phase++){
+                vector<double> t = phase ? c.merging : c.partition;
+                sort(t.begin(), t.end());
+                json << ", \"" << (phase ? "merging" : c.used == Engine::HertelMehlhorn ? "triangulate" : "algorithm1") << "\": {\"reps\": " << t.size() << ", \"mean\": "
+                     << accumulate(t.begin(), t.end(), 0.0) / t.size();
+                for(int k = 0; k < 5; k++) json << ", \"" << PERCENTILE_NAMES[k] << "\": " << percentile(t, PERCENTILES[k]);
+                json << "}";
+            }
+            METRIC(json << ", \"metrics\": {" << c.metrics.json() << "}");
+            if(!c.updates.empty()){
+                vector<double> t = c.updates;
+                sort(t.begin(), t.end());
+                json << ", \"update\": {\"reps\": " << t.size() << ", \"mean\": " << accumulate(t.begin(), t.end(), 0.0) / t.size();
+                for(int k = 0; k < 5; k++) json << ", \"" << PERCENTILE_NAMES[k] << "\": " << percentile(t, PERCENTILES[k]);
+                json << ", \"pieces\": " << c.editPieces << ", \"flips\": " << c.flips;
+                if(verify) json << ", \"failures\": " << c.failures << ", \"extraPieces\": " << c.extraPieces;
+                json << "}, \"recompute\": {\"seconds\": " << c.recompute << ", \"pieces\": " << c.recomputePieces << "}";
+            }
+            if(!c.multiStarts.empty()){
+                json << ", \"starts\": [";
+                for(size_t k = 0; k < c.multiStarts.size(); k++){
+                    const MultiStart& r = c.multiStarts[k];
+                    json << (k ? ", " : "") << "{\"starts\": " << r.starts << ", \"prune\": " << (r.prune ? "true" : "false") << ", \"tried\": " << r.tried
+                         << ", \"pruned\": " << r.pruned << ", \"start\": " << r.start << ", \"diagonals\": " << r.diagonals
+                         << ", \"pieces\": " << r.pieces << ", \"seconds\": " << r.seconds << "}";
+                }
+                json << "]";
+            }
+            json << "}";
+        }
+        json << "\n  ]\n}\n";
+        if(!json){
+            cerr << "Error writing " << jsonPath << "\n";
+            return 1;
+        }
+    }
+    for(const BenchCase& c: cases) if(c.failures) return 1; // so that --verify can fail a script
+    return 0;
+}
+
+bool FrameReader::read(void* out, size_t len){
+    char* to = (char*)out;
+    while(len > 0){
+        if(this->begin == this->end){
+            bool direct = len >= this->buffer.size(); // a big body goes straight where it belongs, without a copy
+            ssize_t r = ::read(this->fd, direct ? to : this->buffer.data(), direct ? len : this->buffer.size());
+            if(r < 0 and errno == EINTR) continue;
+            if(r <= 0) return false;
+            if(direct){
+                to += r;
+                len -= r;
+                continue;
+            }
+            this->begin = 0;
+            this->end = r;
+        }
+        size_t take = min(len, this->end - this->begin);
+        memcpy(to, this->buffer.data() + this->begin, take);
+        this->begin += take;
+        to += take;
+        len -= take;
+    }
+    return true;
+}
+
+bool writeAll(int fd, const char* data, size_t len){
+    while(len > 0){
+        ssize_t w = write(fd, data, len);
+        if(w < 0 and errno == EINTR) continue;
+        if(w <= 0) return false;
+        data += w;
+        len -= w;
+    }
+    return true;
+}
+
+void ServiceStats::record(uint32_t kind, double latency){
+    lock_guard<mutex> guard(this->lock);
+    if(kind == SERVICE_ERROR) this->errors++;
+    if(kind != SERVICE_DECOMPOSE) return;
+    if(this->latencies.size() < LATENCY_WINDOW) this->latencies.push_back(latency);
+    else{
+        this->latencies[this->next] = latency;
+        this->next = (this->next + 1) % LATENCY_WINDOW;
+    }
+}
+
+string ServiceStats::json(size_t queued){
+    unique_lock<mutex> guard(this->lock);
+    vector<double> sorted = this->latencies;
+    double seconds = steadySeconds() - this->started;
+    ostringstream out;
+    out << setprecision(9) << "{\"seconds\": " << seconds << ", \"requests\": " << this->requests << ", \"polygons\": " << this->work.polygons
+        << ", \"vertices\": " << this->work.vertices << ", \"errors\": " << this->errors << ", \"rejected\": " << this->rejected
+        << ", \"queued\": " << queued << ", \"polygons/s\": " << this->work.polygons / seconds << ", \"decompose-cpu-s\": " << this->work.decomposeTime
+        << ", \"cache-hits\": " << this->work.cacheHits + this->work.diskHits;
+    guard.unlock(); // the sort takes a while with a full window, the workers need the lock meanwhile
+    sort(sorted.begin(), sorted.end());
+    out << ", \"latency\": {\"count\": " << sorted.size();
+    const pair<const char*, double> PERCENTILES[] = {{"p50", 50}, {"p90", 90}, {"p99", 99}, {"p99.9", 99.9}, {"max", 100}};
+    for(auto [name, p]: PERCENTILES) out << ", \"" << name << "\": " << (sorted.empty() ? 0 : percentile(sorted, p));
+    out << "}}";
+    return out.str();
+}
+
+Connection::~Connection(){
+    if(this->in > 2) close(this->in); // stdin and stdout stay open, the process is about to end anyway
+    if(this->out > 2 and this->out != this->in) close(this->out);
+}
+
+void Connection::send(uint64_t sequence, Reply&& reply){
+    lock_guard<mutex> guard(this->lock);
+    this->unsent += sizeof(ServiceFrame) + reply.body.size();
+    if(this->ordered and sequence != this->next){
+        this->pending.emplace(sequence, move(reply));
+        return;
+    }
+    auto put = [&](Reply& r){
+        r.frame.length = r.body.size();
+        const char* head = (const char*)&r.frame;
+        this->buffer.insert(this->buffer.end(), head, head + sizeof(ServiceFrame));
+        this->buffer.insert(this->buffer.end(), r.body.begin(), r.body.end());
+        this->kinds.push_back({r.frame.kind, r.arrived});
+    };
+    put(reply);
+    if(this->ordered){ // the replies that waited for this one go out with it, in one write()
+        this->next++;
+        for(auto it = this->pending.begin(); it != this->pending.end() and it->first == this->next; it = this->pending.erase(it)){
+            put(it->second);
+            this->next++;
+        }
+    }
+    this->ready.notify_one();
+}
+
+void Connection::finish(uint64_t count){
+    lock_guard<mutex> guard(this->lock);
+    this->total = count;
+    this->ready.notify_one();
+}
+
+void Connection::waitRoom(){
+    unique_lock<mutex> guard(this->lock);
+    this->room.wait(guard, [&](){ return this->unsent < SERVICE_MAX_BYTES or this->broken; });
+}
+
+void Connection::drain(){
+    vector<char> out;
+    vector<pair<uint32_t, double>> kinds;
+    unique_lock<mutex> guard(this->lock);
+    while(true){
+        this->ready.wait(guard, [&](){ return !this->buffer.empty() or this->written == this->total; });
+        if(this->buffer.empty()) return;
+        swap(out, this->buffer); // the workers fill the other buffer while we write this one
+        swap(kinds, this->kinds);
+        bool broken = this->broken;
+        guard.unlock();
+        double now = steadySeconds(); // before the write, so that a client that got its reply finds it counted
+        for(auto [kind, arrived]: kinds) this->stats->record(kind, now - arrived);
+        if(!broken and !writeAll(this->out, out.data(), out.size())) broken = true;
+        guard.lock();
+        this->broken |= broken;
+        this->unsent -= out.size();
+        this->written += kinds.size();
+        out.clear();
+        kinds.clear();
+        this->room.notify_all();
+    }
+}
+
+bool RequestQueue::push(Request& request, bool wait){
+    unique_lock<mutex> guard(this->lock);
+    if(wait) this->notFull.wait(guard, [&](){ return this->requests.size() < this->depth; });
+    else if(this->requests.size() >= this->depth) return false;
+    this->requests.push_back(move(request));
+    guard.unlock();
+    this->notEmpty.notify_one();
+    return true;
+}
+
+bool RequestQueue::pop(vector<Request>& batch, size_t most){
+    batch.clear();
+    unique_lock<mutex> guard(this->lock);
+    this->notEmpty.wait(guard, [&](){ return !this->requests.empty() or this->closed; });
+    if(this->requests.empty()) return false;
+    size_t take = min(most, (this->requests.size() + this->workers - 1) / this->workers); // our share of the queue, at least one
+    for(size_t i = 0; i < take; i++){
+        batch.push_back(move(this->requests.front()));
+        this->requests.pop_front();
+    }
+    guard.unlock();
+    this->notFull.notify_all();
+    return true;
+}
+
+void RequestQueue::close(){
+    lock_guard<mutex> guard(this->lock);
+    this->closed = true;
+    this->notEmpty.notify_all();
+}
+
+size_t RequestQueue::size(){
+    lock_guard<mutex> guard(this->lock);
+    return this->requests.size();
+}
+
+void serveConnection(const shared_ptr<Connection>& connection, RequestQueue& queue, ServiceStats& stats, bool wait){
+    FrameReader reader{connection->in};
+    ServiceFrame frame;
+    uint64_t sequence = 0;
+    for(; connection->waitRoom(), reader.read(&frame, sizeof(ServiceFrame)); sequence++){
+        double arrived = steadySeconds();
+        {
+            lock_guard<mutex> guard(stats.lock);
+            stats.requests++;
+        }
+        auto fail = [&](const string& message){
+            connection->send(sequence, Reply{{SERVICE_ERROR, 0, frame.tag}, vector<char>(message.begin(), message.end()), arrived});
+        };
+        if(frame.length > SERVICE_MAX_BYTES){
+            fail("the frame is longer than " + to_string(SERVICE_MAX_BYTES) + " bytes, a polygon of " + to_string(SERVICE_MAX_VERTICES) + " vertices");
+            sequence++;
+            break;
+        }
+        // the body is read in chunks that are at most as big as what already came, so that a header alone costs no memory
+        Request request{connection, sequence, frame.tag, arrived, {}};
+        bool whole = true;
+        while(whole and request.bytes.size() < frame.length){
+            size_t have = request.bytes.size(), chunk = min<size_t>(frame.length - have, max<size_t>(have, 1 << 16));
+            request.bytes.resize(have + chunk);
+            whole = reader.read(request.bytes.data() + have, chunk);
+        }
+        if(!whole) break; // the stream ended inside the body, there is no request to answer
+        if(frame.kind == SERVICE_STATS){
+            string text = stats.json(queue.size());
+            connection->send(sequence, Reply{{SERVICE_STATS, 0, frame.tag}, vector<char>(text.begin(), text.end()), arrived});
+        }
+        else if(frame.kind != SERVICE_DECOMPOSE) fail("unknown kind of frame " + to_string(frame.kind));
+        else if(!queue.push(request, wait)){
             {
-                double x,y;cin>>x>>y;
-                inp.push_back(new Vertex(x,y));
-            }
-            //reverse(inp.begin(), inp.end()); //for clockwise, uncomment this line
-
-            DCEL* polygon = new DCEL(inp);
-            polygon->algorithm1();
-            polygon->merging();
-  
-            for(auto poly: polygon->faces){
-                if(!polygon->LDP[polygon->mp1[poly]]) continue;
-                HalfEdge* e = poly->outerComponent, *start = e;
-                do{
-                    cout<<e->origin->x<<", "<<e->origin->y<<endl;
-                    e = e->next;
-                } while(e!=start);
-                cout<<endl;
+                lock_guard<mutex> guard(stats.lock);
+                stats.rejected++;
+            }
+            fail("the queue is full");
+        }
+    }
+    connection->finish(sequence); // every frame read whole got a reply
+}
+
+/// @brief The listening socket of daa serve, for stopService
+int serviceListener = -1;
+
+/// @brief Set by stopService once SIGINT or SIGTERM came
+volatile sig_atomic_t serviceStopping = 0;
+
+/// @brief Signal handler of daa serve on a socket, stops accepting connections. serveMain then ends the ones that are open
+void stopService(int){
+    serviceStopping = 1;
+    if(serviceListener >= 0) shutdown(serviceListener, SHUT_RDWR); // wakes accept() whichever thread got the signal
+}
+
+int serveMain(int argc, char** argv){
+    string socketPath;
+    int threads = max(1u, thread::hardware_concurrency());
+    size_t depth = 256, most = 8;
+    bool wait = true, ordered = true;
+    MultiStart multiStart;
+    Engine engine = Engine::MP1;
+    double cacheMiB = 0;
+    string cachePath;
+    for(int i = 2; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--exhaustive"){
+            multiStart.prune = false;
+            continue;
+        }
+        if(i+1 >= argc){
+            printUsage();
+            return 1;
+        }
+        string value = argv[++i];
+        if(arg == "--socket") socketPath = value;
+        else if(arg == "-t") threads = max(1, atoi(value.c_str()));
+        else if(arg == "--queue") depth = max(1, atoi(value.c_str()));
+        else if(arg == "--batch") most = max(1, atoi(value.c_str()));
+        else if(arg == "--overload" and (value == "block" or value == "reject")) wait = value == "block";
+        else if(arg == "--order" and (value == "request" or value == "tag")) ordered = value == "request";
+        else if(arg == "--starts") multiStart.starts = max(1, atoi(value.c_str()));
+        else if(arg == "--starts-budget") multiStart.budget = atof(value.c_str());
+        else if(arg == "--cache") cacheMiB = max(0.0, atof(value.c_str()));
+        else if(arg == "--cache-file") cachePath = value;
+        else if(arg == "--engine"){
+            int k = find(begin(ENGINE_NAMES), end(ENGINE_NAMES), value) - begin(ENGINE_NAMES);
+            if(k == 3){
+                cerr << "Unknown engine " << value << "\n";
+                return 1;
+            }
+            engine = (Engine)k;
+        }
+        else{
+            printUsage();
+            return 1;
+        }
+    }
+
+    ResultCache cache;
+    bool caching = cacheMiB > 0 or !cachePath.empty();
+    if(caching and !cache.open((cacheMiB > 0 ? cacheMiB : 256) * 1024 * 1024, cachePath)){
+        cerr << "Error opening " << cachePath << ", it is not a cache container\n";
+        return 1;
+    }
+    int listener = -1;
+    if(!socketPath.empty()){
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if(socketPath.size() >= sizeof(address.sun_path)){
+            cerr << "The socket path " << socketPath << " is too long\n";
+            return 1;
+        }
+        strcpy(address.sun_path, socketPath.c_str());
+        unlink(socketPath.c_str()); // the socket of a server that was killed is still there
+        listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listener < 0 or ::bind(listener, (sockaddr*)&address, sizeof(address)) < 0 or listen(listener, 128) < 0){
+            cerr << "Error listening on " << socketPath << "\n";
+            return 1;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN); // a client that goes away makes write() fail instead of ending the server
+
+    // every worker keeps its Worker, with the DCEL, the arenas of the other layouts and the output buffer, warm for all the requests
+    ServiceStats stats;
+    stats.started = steadySeconds();
+    RequestQueue queue(depth, threads);
+    vector<Worker> workers(threads);
+    auto work = [&](Worker& worker){
+        vector<Request> batch;
+        while(queue.pop(batch, most)){
+            for(Request& request: batch){
+                Job job{"", "", recordName(request.bytes.data(), request.bytes.size()), request.bytes.size()};
+                job.request = &request.bytes;
+                job.result = &request.bytes; // the decomposition replaces the polygon in the buffer of the request
+                Reply reply{{SERVICE_DECOMPOSE, 0, request.tag}, {}, request.arrived};
+                if(!worker.run(job)){
+                    string message = "Error reading " + job.name + ", it is not a polygon record";
+                    reply.frame.kind = SERVICE_ERROR;
+                    request.bytes.assign(message.begin(), message.end());
+                }
+                reply.body = move(request.bytes);
+                {
+                    lock_guard<mutex> guard(stats.lock); // before the reply, so that a client that got it finds it counted
+                    stats.work.add(worker.stats);
+                    worker.stats = BatchStats();
+                }
+                request.connection->send(request.sequence, move(reply));
+            }
+        }
+    };
+    vector<thread> pool;
+    for(Worker& w: workers){
+        w.multiStart = multiStart;
+        w.engine = engine;
+        w.cache = caching ? &cache : nullptr;
+        pool.emplace_back(work, ref(w));
+    }
+
+    // every connection gets a writer thread, which holds it until all of its replies are written. We wait for them at the end
+    mutex writerLock;
+    condition_variable flushed;
+    int writers = 0;
+    auto connect = [&](int in, int out){
+        auto connection = make_shared<Connection>(in, out, ordered, &stats);
+        lock_guard<mutex> guard(writerLock);
+        writers++;
+        thread([&, connection]() mutable {
+            connection->drain();
+            connection.reset(); // the descriptors are closed here unless the reader still has them
+            lock_guard<mutex> guard(writerLock);
+            writers--;
+            flushed.notify_all();
+        }).detach();
+        return connection;
+    };
+
+    if(listener < 0) serveConnection(connect(0, 1), queue, stats, wait);
+    else{
+        serviceListener = listener;
+        struct sigaction action{};
+        action.sa_handler = stopService;
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        cerr << "listening on " << socketPath << "\n";
+
+        // every connection gets a thread that reads its requests, we keep the connections to end them when we stop
+        mutex lock;
+        condition_variable ended;
+        int readers = 0;
+        vector<weak_ptr<Connection>> connections;
+        while(!serviceStopping){
+            int fd = accept(listener, nullptr, nullptr);
+            if(fd < 0 and (errno == EINTR or errno == ECONNABORTED)) continue;
+            if(fd < 0 or serviceStopping){
+                if(fd >= 0) close(fd);
+                break;
+            }
+            auto connection = connect(fd, fd);
+            {
+                lock_guard<mutex> guard(lock);
+                connections.erase(remove_if(connections.begin(), connections.end(), [](const weak_ptr<Connection>& c){ return c.expired(); }), connections.end());
+                connections.push_back(connection);
+                readers++;
+            }
+            thread([&, connection](){
+                serveConnection(connection, queue, stats, wait);
+                lock_guard<mutex> guard(lock);
+                readers--;
+                ended.notify_all();
+            }).detach();
+        }
+        unique_lock<mutex> guard(lock);
+        for(const weak_ptr<Connection>& c: connections){ // the readers see the end of their stream, the requests they read are still served
+            if(shared_ptr<Connection> open = c.lock()) shutdown(open->in, SHUT_RD);
+        }
+        ended.wait(guard, [&](){ return readers == 0; });
+        close(listener);
+        unlink(socketPath.c_str());
+    }
+    queue.close();
+    for(thread& t: pool) t.join();
+    {
+        unique_lock<mutex> guard(writerLock);
+        flushed.wait(guard, [&](){ return writers == 0; });
+    }
+    if(caching and !cache.save()){
+        cerr << "Error writing " << cachePath << "\n";
+        return 1;
+    }
+    cerr << stats.json(0) << "\n";
+    return 0;
+}
+
+int loadMain(int argc, char** argv){
+    string socketPath;
+    vector<Shape> shapes = {Shape::Random};
+    vector<int> sizes = {100};
+    size_t requests = 10000, window = 64, distinct = 64;
+    double rate = 0;
+    uint64_t seed = 1;
+    vector<char*> serveArgs; // the options after --, for the server we start
+    for(int i = 2; i < argc; i++){
+        string arg = argv[i];
+        if(arg == "--"){
+            serveArgs.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        if(i+1 >= argc){
+            printUsage();
+            return 1;
+        }
+        string value = argv[++i];
+        istringstream items(value);
+        string item;
+        if(arg == "--socket") socketPath = value;
+        else if(arg == "--requests") requests = max(1.0, stod(value));
+        else if(arg == "--rate") rate = max(0.0, atof(value.c_str()));
+        else if(arg == "--window") window = max(1, atoi(value.c_str()));
+        else if(arg == "--distinct") distinct = max(1, atoi(value.c_str()));
+        else if(arg == "--seed") seed = strtoull(value.c_str(), nullptr, 10);
+        else if(arg == "--shapes"){
+            shapes.clear();
+            while(getline(items, item, ',')){
+                int k = find(begin(SHAPE_NAMES), end(SHAPE_NAMES), item) - begin(SHAPE_NAMES);
+                if(k == 5){
+                    cerr << "Unknown shape " << item << "\n";
+                    return 1;
+                }
+                shapes.push_back((Shape)k);
+            }
+        }
+        else if(arg == "--sizes"){
+            sizes.clear();
+            while(getline(items, item, ',')) if(!item.empty()) sizes.push_back(max(4, (int)stod(item)));
+        }
+        else{
+            printUsage();
+            return 1;
+        }
+    }
+    if(shapes.empty() or sizes.empty()){
+        printUsage();
+        return 1;
+    }
+
+    // the frames of the distinct polygons are made once, every request only gets its tag written into one of them
+    vector<vector<char>> frames(distinct);
+    vector<size_t> counts(distinct);
+    vector<Vertex> points;
+    DCEL polygon;
+    for(size_t i = 0; i < distinct; i++){
+        Shape shape = shapes[i % shapes.size()];
+        int n = sizes[i / shapes.size() % sizes.size()];
+        generatePolygon(shape, n, seed + i, points);
+        polygon.reset();
+        for(const Vertex& v: points) polygon.addVertex(v.x, v.y);
+        vector<char> record;
+        encodePolygon(polygon, string(SHAPE_NAMES[(int)shape]) + "_" + to_string(n) + "_" + to_string(i), record);
+        append(frames[i], ServiceFrame{SERVICE_DECOMPOSE, (uint32_t)record.size(), 0});
+        frames[i].insert(frames[i].end(), record.begin(), record.end());
+        counts[i] = points.size();
+    }
+
+    int to = -1, from = -1;
+    pid_t child = -1;
+    if(!socketPath.empty()){
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+        to = from = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(to < 0 or connect(to, (sockaddr*)&address, sizeof(address)) < 0){
+            cerr << "Error connecting to " << socketPath << "\n";
+            return 1;
+        }
+    }
+    else{ // we start the server ourselves and talk to it over its stdin and stdout
+        int up[2], down[2];
+        if(pipe(up) < 0 or pipe(down) < 0 or (child = fork()) < 0){
+            cerr << "Error starting daa serve\n";
+            return 1;
+        }
+        if(child == 0){
+            dup2(up[0], 0);
+            dup2(down[1], 1);
+            for(int fd: {up[0], up[1], down[0], down[1]}) close(fd);
+            vector<char*> args = {argv[0], (char*)"serve"};
+            args.insert(args.end(), serveArgs.begin(), serveArgs.end());
+            args.push_back(nullptr);
+            execv("/proc/self/exe", args.data());
+            _exit(127);
+        }
+        close(up[0]);
+        close(down[1]);
+        to = up[1];
+        from = down[0];
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    // tag i is request i, the tag after the last one is the SERVICE_STATS request at the end
+    mutex lock;
+    condition_variable replied;
+    vector<double> sent(requests), latency(requests);
+    size_t inflight = 0, received = 0, errors = 0;
+    uint64_t pieces = 0;
+    double last = 0;
+    bool closed = false;
+    string serverStats, firstError;
+    thread receiver([&](){
+        FrameReader reader{from};
+        ServiceFrame frame;
+        vector<char> body;
+        while(reader.read(&frame, sizeof(ServiceFrame))){
+            body.resize(frame.length);
+            if(!reader.read(body.data(), frame.length)) break;
+            double now = steadySeconds();
+            lock_guard<mutex> guard(lock);
+            if(frame.tag == requests) serverStats.assign(body.begin(), body.end());
+            else if(frame.tag < requests){
+                latency[frame.tag] = now - sent[frame.tag];
+                if(frame.kind == SERVICE_DECOMPOSE and body.size() >= 12){
+                    uint32_t count;
+                    memcpy(&count, body.data() + 8, 4);
+                    pieces += count;
+                }
+                else if(errors++ == 0) firstError.assign(body.begin(), body.end());
+                inflight--;
+                received++;
+                last = now;
             }
-            clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &st2);
-            double tim = (((double)st2.tv_sec*1.0e9 + st2.tv_nsec) - ((double)st1.tv_sec*1.0e9 + st1.tv_nsec))/1.0e9;
-            cout<<tim<<endl;
+            replied.notify_all();
+        }
+        lock_guard<mutex> guard(lock);
+        closed = true;
+        replied.notify_all();
+    });
+
+    double start = steadySeconds();
+    uint64_t vertices = 0;
+    size_t count = 0;
+    for(; count < requests; count++){
+        double due = start + count / rate;
+        if(rate > 0) this_thread::sleep_for(chrono::duration<double>(due - steadySeconds()));
+        {
+            unique_lock<mutex> guard(lock);
+            replied.wait(guard, [&](){ return inflight < window or closed; });
+            if(closed) break;
+            inflight++;
+            sent[count] = rate > 0 ? due : steadySeconds(); // with a rate we count from when the request was due, so a server that falls
+                                                             // behind is not hidden by the requests we could only send late
+        }
+        vector<char>& frame = frames[count % distinct];
+        uint64_t tag = count;
+        memcpy(frame.data() + 8, &tag, 8);
+        vertices += counts[count % distinct];
+        if(!writeAll(to, frame.data(), frame.size())) break;
+    }
+    {
+        unique_lock<mutex> guard(lock);
+        replied.wait(guard, [&](){ return received == count or closed; });
+    }
+    ServiceFrame ask{SERVICE_STATS, 0, requests};
+    if(writeAll(to, (const char*)&ask, sizeof(ServiceFrame))){
+        unique_lock<mutex> guard(lock);
+        replied.wait(guard, [&](){ return !serverStats.empty() or closed; });
+    }
+    if(to == from) shutdown(to, SHUT_WR); // the server ends the connection, or stops, once it has seen the end of the requests
+    else close(to);
+    receiver.join();
+    close(from);
+    if(child > 0) waitpid(child, nullptr, 0);
+
+    vector<double> sorted(latency.begin(), latency.begin() + received);
+    sort(sorted.begin(), sorted.end());
+    double seconds = last - start;
+    cerr << "requests  errors  pieces  seconds  requests/s  vertices/s  p50-ms  p90-ms  p99-ms  max-ms\n";
+    cerr << received << "  " << errors << "  " << pieces << "  " << seconds << "  " << received / seconds << "  " << vertices / seconds;
+    for(double p: {50.0, 90.0, 99.0, 100.0}) cerr << "  " << (sorted.empty() ? 0 : percentile(sorted, p) * 1000);
+    cerr << "\n";
+    if(errors) cerr << "first error: " << firstError << "\n";
+    if(!serverStats.empty()) cerr << "server  " << serverStats << "\n";
+    if(received < requests){
+        cerr << "Error: only " << received << " of " << requests << " requests were answered\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv){
+    /**
+     * @brief This is the main function.
+     * We open and loop through the input folders and create respective output folders
+     * For each input we read, we start a timer, create the DCEL, and call the functions algorithmi(); and merging();
+     * Then we print the result into the output file
+     * A single Worker, with its DCEL and buffers, is reused for every input so they are only allocated once
+     * "daa batch ...", "daa pack ...", "daa unpack ...", "daa parallel ...", "daa bench ...", "daa serve ..." and "daa load ..." run
+     * the batch mode, the binary converters, the parallel decomposition of one polygon, the benchmark, the decomposition service and
+     * its load generator instead, see printUsage()
+     */
+
+    //PRITHVI RAJAN 2020A7PS2080H
+    //PRAJWAL NAYAK 2020A7PS2059H
+    //MEDINI N B 2020A7PS1722H
+
+    if(argc > 1){
+        if(string(argv[1]) == "batch") return batchMain(argc, argv);
+        if(string(argv[1]) == "pack") return packMain(argc, argv);
+        if(string(argv[1]) == "unpack") return unpackMain(argc, argv);
+        if(string(argv[1]) == "bench") return benchMain(argc, argv);
+        if(string(argv[1]) == "parallel") return parallelMain(argc, argv);
+        if(string(argv[1]) == "serve") return serveMain(argc, argv);
+        if(string(argv[1]) == "load") return loadMain(argc, argv);
+        printUsage();
+        return 1;
+    }
+
+    mkdir("./decomposed", 0777);
+    Worker worker;
+
+    //below for loop is for n folders that we used for testing
+    for(int n=8; n<=30; n++) {
+
+        string input_folder = "./polygons_input/" + to_string(n) + "/";
+        string output_folder = "./decomposed/" + to_string(n) + "/";
+
+        int result = mkdir(output_folder.c_str(), 0777); // create output folder if it doesn't exist
+
+        if (result == -1) {
+            perror("Error creating decomposed directory");
+            return 1;
+        }
+
+        //below for loop is for reading 10 input text files that we used for testing
+        for(int i=1; i<=10; i++) {
+
+            string input_file = input_folder + to_string(n) + "_" + to_string(i) + ".txt";
+            string output_file = output_folder + to_string(n) + "_" + to_string(i) + ".txt";
+
+            worker.run({input_file, output_file, input_file, 0});
         }
     }
-}
\ No newline at end of file
+}